@@ -0,0 +1,271 @@
+// Session snapshot benchmark: binary snapshots against a JSON baseline.
+//
+// Fills TAB_COUNT tabs with LINES_PER_TAB lines of scrollback each, then
+// times saving and restoring them both ways. The JSON baseline writes the
+// same content as escaped strings and restores it by parsing every string
+// back into a line, which is what a JSON session restore has to do.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "session_snapshot.h"
+#include "terminal.h"
+#include "scrollback.h"
+#include "tabs.h"
+#include "scripting.h"
+
+#define TAB_COUNT 50
+#define LINES_PER_TAB 10000
+#define LINES_PER_INCREMENT 100
+#define TERMINAL_WIDTH 120
+#define TERMINAL_HEIGHT 40
+
+#define SNAPSHOT_PATH "/tmp/mterm_snapshot_bench.mtsnap"
+#define JSON_PATH "/tmp/mterm_snapshot_bench.json"
+
+// triggers.m calls into the scripting engine, which needs Foundation
+int scripting_engine_trigger_event(ScriptingEngine* engine, const char* event_name, const char* data) {
+    (void)engine;
+    (void)event_name;
+    (void)data;
+    return 0;
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static long file_size(const char *path) {
+    struct stat st;
+    return (stat(path, &st) == 0) ? (long)st.st_size : -1;
+}
+
+static void feed_lines(Terminal *terminal, int tab, int first, int count) {
+    char line[160];
+    
+    for (int i = first; i < first + count; i++) {
+        int length = snprintf(line, sizeof(line),
+                              "[tab %d] 2026-10-19T12:00:%02d INFO worker-%d: request %d handled \"ok\" in %d ms\r\n",
+                              tab, i % 60, i % 8, i, i % 300);
+        terminal_write(terminal, line, length);
+    }
+}
+
+static void json_write_string(FILE *file, const char *text, int length) {
+    fputc('"', file);
+    for (int i = 0; i < length; i++) {
+        char c = text[i];
+        if (c == '"' || c == '\\') fputc('\\', file);
+        fputc(c, file);
+    }
+    fputc('"', file);
+}
+
+static int json_save(TabManager *manager) {
+    FILE *file = fopen(JSON_PATH, "w");
+    if (!file) return -1;
+    
+    fprintf(file, "{\"active\":%d,\"tabs\":[", tab_manager_get_active_tab_index(manager));
+    
+    for (int i = 0; i < tab_manager_get_tab_count(manager); i++) {
+        Tab *tab = tab_manager_get_tab(manager, i);
+        Terminal *terminal = tab_get_terminal(tab);
+        Scrollback *scrollback = terminal_get_scrollback(terminal);
+        const char *title = tab_get_title(tab);
+        
+        fputs(i ? ",{\"title\":" : "{\"title\":", file);
+        json_write_string(file, title, (int)strlen(title));
+        fprintf(file, ",\"width\":%d,\"height\":%d,\"cursor_x\":%d,\"cursor_y\":%d,\"screen\":",
+                terminal_get_width(terminal), terminal_get_height(terminal),
+                terminal_get_cursor_x(terminal), terminal_get_cursor_y(terminal));
+        json_write_string(file, terminal_get_text(terminal), terminal_get_width(terminal) * terminal_get_height(terminal));
+        fputs(",\"lines\":[", file);
+        
+        for (int j = 0; j < scrollback_get_line_count(scrollback); j++) {
+            const char *line = scrollback_get_line(scrollback, j);
+            if (j) fputc(',', file);
+            json_write_string(file, line, (int)strlen(line));
+        }
+        fputs("]}", file);
+    }
+    
+    fputs("]}", file);
+    return fclose(file);
+}
+
+// Read the file and unescape every string into its own allocation, the
+// least a JSON restore does before it can hand lines to a scrollback
+static int json_restore(long *out_strings) {
+    FILE *file = fopen(JSON_PATH, "r");
+    if (!file) return -1;
+    
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    
+    char *data = (char *)malloc(size);
+    if (!data || fread(data, 1, size, file) != (size_t)size) {
+        free(data);
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+    
+    long strings = 0;
+    for (long i = 0; i < size; i++) {
+        if (data[i] != '"') continue;
+        
+        long end = i + 1;
+        while (end < size && data[end] != '"') {
+            end += (data[end] == '\\') ? 2 : 1;
+        }
+        
+        char *string = (char *)malloc(end - i);
+        int length = 0;
+        for (long j = i + 1; j < end; j++) {
+            if (data[j] == '\\') j++;
+            string[length++] = data[j];
+        }
+        string[length] = '\0';
+        free(string);
+        
+        strings++;
+        i = end;
+    }
+    
+    free(data);
+    *out_strings = strings;
+    return 0;
+}
+
+int main(void) {
+    TabManager *manager = tab_manager_create(TAB_COUNT);
+    Terminal *terminals[TAB_COUNT];
+    
+    unlink(SNAPSHOT_PATH);
+    
+    for (int i = 0; i < TAB_COUNT; i++) {
+        terminals[i] = terminal_create(TERMINAL_WIDTH, TERMINAL_HEIGHT);
+        terminal_set_scrollback(terminals[i], scrollback_create(LINES_PER_TAB));
+        tab_set_terminal(tab_manager_add_tab(manager, "logs"), terminals[i]);
+        feed_lines(terminals[i], i, 0, LINES_PER_TAB + TERMINAL_HEIGHT);
+    }
+    tab_manager_set_active_tab(manager, TAB_COUNT / 2);
+    
+    printf("%d tabs x %d scrollback lines\n\n", TAB_COUNT, LINES_PER_TAB);
+    
+    // Binary save: first save writes everything, later ones only what changed
+    SessionSnapshotWriter *writer = session_snapshot_writer_create(SNAPSHOT_PATH);
+    if (!writer) {
+        fprintf(stderr, "cannot create %s\n", SNAPSHOT_PATH);
+        return 1;
+    }
+    
+    double start = now_ms();
+    int result = session_snapshot_writer_save(writer, manager);
+    double full_save = now_ms() - start;
+    
+    for (int i = 0; i < TAB_COUNT; i++) {
+        feed_lines(terminals[i], i, LINES_PER_TAB + TERMINAL_HEIGHT, LINES_PER_INCREMENT);
+    }
+    
+    start = now_ms();
+    result |= session_snapshot_writer_save(writer, manager);
+    double incremental_save = now_ms() - start;
+    
+    start = now_ms();
+    result |= session_snapshot_writer_save(writer, manager);
+    double unchanged_save = now_ms() - start;
+    
+    session_snapshot_writer_destroy(writer);
+    
+    if (result < 0) {
+        fprintf(stderr, "binary save failed\n");
+        return 1;
+    }
+    
+    // Binary restore: open is lazy, a full restore touches every line and screen
+    start = now_ms();
+    SessionSnapshot *snapshot = session_snapshot_open(SNAPSHOT_PATH);
+    double open_time = now_ms() - start;
+    
+    if (!snapshot) {
+        fprintf(stderr, "cannot open %s\n", SNAPSHOT_PATH);
+        return 1;
+    }
+    
+    Terminal *restored = terminal_create(TERMINAL_WIDTH, TERMINAL_HEIGHT);
+    long restored_bytes = 0;
+    int mismatches = 0;
+    
+    session_snapshot_set_max_lines(snapshot, LINES_PER_TAB);
+    
+    start = now_ms();
+    for (int i = 0; i < session_snapshot_get_tab_count(snapshot); i++) {
+        session_snapshot_restore_screen(snapshot, i, restored);
+        for (int j = 0; j < session_snapshot_get_line_count(snapshot, i); j++) {
+            restored_bytes += (long)strlen(session_snapshot_get_line(snapshot, i, j));
+        }
+    }
+    double full_restore = now_ms() - start;
+    
+    // Check a tab against its live scrollback
+    Scrollback *expected = terminal_get_scrollback(terminals[TAB_COUNT - 1]);
+    if (session_snapshot_get_line_count(snapshot, TAB_COUNT - 1) != scrollback_get_line_count(expected)) {
+        mismatches = -1;
+    } else {
+        for (int j = 0; j < scrollback_get_line_count(expected); j++) {
+            if (strcmp(session_snapshot_get_line(snapshot, TAB_COUNT - 1, j), scrollback_get_line(expected, j)) != 0) {
+                mismatches++;
+            }
+        }
+    }
+    
+    session_snapshot_close(snapshot);
+    
+    // JSON baseline
+    start = now_ms();
+    result = json_save(manager);
+    double json_save_time = now_ms() - start;
+    
+    long strings = 0;
+    start = now_ms();
+    result |= json_restore(&strings);
+    double json_restore_time = now_ms() - start;
+    
+    if (result < 0) {
+        fprintf(stderr, "JSON baseline failed\n");
+        return 1;
+    }
+    
+    printf("binary  file %8.1f MB\n", file_size(SNAPSHOT_PATH) / 1e6);
+    printf("        save %8.1f ms full, %.2f ms incremental (+%d lines/tab), %.2f ms unchanged\n",
+           full_save, incremental_save, LINES_PER_INCREMENT, unchanged_save);
+    printf("        open %8.2f ms (lazy), full restore %.1f ms (%ld bytes of lines)\n",
+           open_time, full_restore, restored_bytes);
+    printf("JSON    file %8.1f MB\n", file_size(JSON_PATH) / 1e6);
+    printf("        save %8.1f ms full (every save)\n", json_save_time);
+    printf("        restore %5.1f ms (read and unescape %ld strings)\n", json_restore_time, strings);
+    
+    terminal_destroy(restored);
+    for (int i = 0; i < TAB_COUNT; i++) {
+        scrollback_destroy(terminal_get_scrollback(terminals[i]));
+        terminal_destroy(terminals[i]);
+    }
+    tab_manager_destroy(manager);
+    
+    unlink(SNAPSHOT_PATH);
+    unlink(JSON_PATH);
+    
+    if (mismatches != 0) {
+        fprintf(stderr, "restored lines do not match the scrollback\n");
+        return 1;
+    }
+    
+    return 0;
+}
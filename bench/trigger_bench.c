@@ -0,0 +1,196 @@
+// Output trigger benchmark: parse cost with 0, 10, 100 and 300 triggers.
+//
+// Feeds LINE_COUNT log lines through terminal_write in 4 KiB reads (as the
+// event loop does) into a terminal with a scrollback attached. Lines are
+// wider than the terminal, so every one of them soft-wraps. Reports the CPU
+// time of the parse thread, which only queues lines, and of the whole
+// process, which includes matching on the trigger thread. Best of RUNS.
+// Overhead is against the same terminal with no trigger engine attached,
+// the median over rounds of each round's ratio, which holds up better than
+// the best times to a machine whose speed drifts.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "terminal.h"
+#include "scrollback.h"
+#include "triggers.h"
+#include "scripting.h"
+
+#define LINE_COUNT 400000
+#define READ_SIZE 4096
+#define RUNS 15
+#define TERMINAL_WIDTH 80
+#define TERMINAL_HEIGHT 40
+#define SCROLLBACK_LINES 10000
+
+#define PLANTED_LINE 39999
+#define PLANTED_PATTERN "request 39999 handled"
+#define NO_ENGINE -1
+
+static long planted_hits = 0;
+static int scripting_stand_in;      // Events are only delivered to a non-NULL engine
+
+// Stands in for the scripting engine, which needs Foundation
+int scripting_engine_trigger_event(ScriptingEngine* engine, const char* event_name, const char* data) {
+    (void)engine;
+    (void)data;
+    if (strcmp(event_name, "planted") == 0) {
+        __atomic_add_fetch(&planted_hits, 1, __ATOMIC_RELAXED);
+    }
+    return 0;
+}
+
+static double cpu_ms(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Patterns that never occur in the log, built from common failure phrases
+static void add_triggers(TriggerEngine *engine, int count) {
+    static const char *subjects[] = {
+        "BUILD", "FATAL", "Segmentation", "Traceback", "Exception", "panic",
+        "Permission", "Connection", "assertion", "Out of", "killed", "OOM",
+        "deadlock", "stack", "unhandled", "[sudo]", "core", "timeout",
+    };
+    static const char *outcomes[] = {
+        "FAILED", "error:", "fault", "(most recent call last)", "in thread",
+        "denied", "refused", "reset by peer", "failed:", "memory", "by signal",
+        "overflow", "detected", "dumped", "password for", "rejected", "expired",
+    };
+    int subject_count = (int)(sizeof(subjects) / sizeof(subjects[0]));
+    int outcome_count = (int)(sizeof(outcomes) / sizeof(outcomes[0]));
+    char pattern[64];
+    
+    // One pattern does occur, once, to check that matching works
+    trigger_engine_add_trigger(engine, PLANTED_PATTERN, "planted");
+    
+    for (int i = 1; i < count; i++) {
+        snprintf(pattern, sizeof(pattern), "%s %s",
+                 subjects[i % subject_count], outcomes[(i / subject_count) % outcome_count]);
+        trigger_engine_add_trigger(engine, pattern, "failure");
+    }
+}
+
+typedef struct {
+    double parse;
+    double process;
+    long long matches;
+    long long dropped;
+} RunResult;
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Feed the whole log once, returns -1 if the planted line did not fire once
+static int run_once(int count, const char *log, int length, RunResult *result) {
+    Terminal *terminal = terminal_create(TERMINAL_WIDTH, TERMINAL_HEIGHT);
+    Scrollback *scrollback = scrollback_create(SCROLLBACK_LINES);
+    TriggerEngine *triggers = NULL;
+    
+    terminal_set_scrollback(terminal, scrollback);
+    if (count != NO_ENGINE) {
+        triggers = trigger_engine_create((ScriptingEngine *)&scripting_stand_in);
+        if (count > 0) add_triggers(triggers, count);
+        terminal_set_trigger_engine(terminal, triggers);
+    }
+    __atomic_store_n(&planted_hits, 0, __ATOMIC_RELAXED);
+    
+    double process_start = cpu_ms(CLOCK_PROCESS_CPUTIME_ID);
+    double parse_start = cpu_ms(CLOCK_THREAD_CPUTIME_ID);
+    
+    for (int offset = 0; offset < length; offset += READ_SIZE) {
+        int size = (length - offset < READ_SIZE) ? length - offset : READ_SIZE;
+        terminal_write(terminal, log + offset, size);
+    }
+    
+    result->parse = cpu_ms(CLOCK_THREAD_CPUTIME_ID) - parse_start;
+    if (triggers) trigger_engine_flush(triggers);
+    result->process = cpu_ms(CLOCK_PROCESS_CPUTIME_ID) - process_start;
+    result->matches = triggers ? trigger_engine_get_match_count(triggers) : 0;
+    result->dropped = triggers ? trigger_engine_get_dropped_count(triggers) : 0;
+    
+    // Unless lines were dropped, the planted line fires exactly once
+    long hits = __atomic_load_n(&planted_hits, __ATOMIC_RELAXED);
+    int status = 0;
+    if (count > 0 && result->dropped == 0 && hits != 1) {
+        fprintf(stderr, "%d triggers: planted line %d fired %ld times\n", count, PLANTED_LINE, hits);
+        status = -1;
+    }
+    
+    trigger_engine_destroy(triggers);
+    scrollback_destroy(scrollback);
+    terminal_destroy(terminal);
+    
+    return status;
+}
+
+int main(void) {
+    static const int trigger_counts[] = { NO_ENGINE, 0, 10, 100, 300 };
+    enum { CONFIGURATIONS = sizeof(trigger_counts) / sizeof(trigger_counts[0]) };
+    
+    char *log = (char *)malloc((size_t)LINE_COUNT * 128);
+    if (!log) return 1;
+    
+    int length = 0;
+    for (int i = 0; i < LINE_COUNT; i++) {
+        length += sprintf(log + length,
+                          "2026-10-19T01:%02d:%02d INFO [worker-%d] request %d handled in %d ms status=200\r\n",
+                          i / 60 % 60, i % 60, i % 16, i, i % 300);
+    }
+    
+    printf("%d lines (%.1f MB) into a %dx%d terminal with %d lines of scrollback\n\n",
+           LINE_COUNT, length / 1e6, TERMINAL_WIDTH, TERMINAL_HEIGHT, SCROLLBACK_LINES);
+    
+    // The app always runs more than one thread. Start one before any timing:
+    // glibc's malloc takes a cheaper path until a process creates its first
+    // thread, which would make the rows without an engine look faster.
+    TriggerEngine *other_thread = trigger_engine_create(NULL);
+    
+    // Configurations take turns in every round, so drift in machine load
+    // affects all of them alike
+    RunResult best[CONFIGURATIONS];
+    double ratios[CONFIGURATIONS][RUNS];
+    int failed = 0;
+    
+    for (int run = 0; run < RUNS; run++) {
+        double baseline = 0;
+        
+        for (int c = 0; c < CONFIGURATIONS; c++) {
+            RunResult result;
+            if (run_once(trigger_counts[c], log, length, &result) < 0) failed = 1;
+            
+            if (c == 0) baseline = result.parse;
+            ratios[c][run] = result.parse / baseline;
+            
+            if (run == 0 || result.parse < best[c].parse) best[c].parse = result.parse;
+            if (run == 0 || result.process < best[c].process) best[c].process = result.process;
+            best[c].matches = result.matches;
+            best[c].dropped = result.dropped;
+        }
+    }
+    
+    printf("triggers   parse thread           overhead     process    matches  dropped\n");
+    
+    for (int c = 0; c < CONFIGURATIONS; c++) {
+        qsort(ratios[c], RUNS, sizeof(double), compare_doubles);
+        double overhead = (ratios[c][RUNS / 2] - 1) * 100;
+        
+        if (trigger_counts[c] == NO_ENGINE) {
+            printf("    none %8.1f ms (%5.1f MB/s)            %8.1f ms\n",
+                   best[c].parse, length / best[c].parse / 1e3, best[c].process);
+        } else {
+            printf("%8d %8.1f ms (%5.1f MB/s) %+7.1f%% %8.1f ms %10lld %8lld\n",
+                   trigger_counts[c], best[c].parse, length / best[c].parse / 1e3,
+                   overhead, best[c].process, best[c].matches, best[c].dropped);
+        }
+    }
+    
+    trigger_engine_destroy(other_thread);
+    free(log);
+    return failed;
+}
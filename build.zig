@@ -112,6 +112,21 @@ pub fn build(b: *std.Build) void {
         .flags = cflags,
     });
 
+    exe.addCSourceFile(.{
+        .file = b.path("src/inc/event_loop.m"),
+        .flags = cflags,
+    });
+
+    exe.addCSourceFile(.{
+        .file = b.path("src/inc/session_snapshot.m"),
+        .flags = cflags,
+    });
+
+    exe.addCSourceFile(.{
+        .file = b.path("src/inc/triggers.m"),
+        .flags = cflags,
+    });
+
     exe.linkLibC();
 
     exe.linkFramework("Cocoa");
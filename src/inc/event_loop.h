@@ -0,0 +1,51 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+typedef struct EventLoop EventLoop;
+
+// Forward declarations
+typedef struct Terminal Terminal;
+typedef struct Shell Shell;
+typedef struct TabManager TabManager;
+
+typedef enum {
+    EVENT_SOURCE_VISIBLE,      // Parsed and rendered
+    EVENT_SOURCE_BACKGROUND,   // Parsed at full throughput, never rendered
+    EVENT_SOURCE_HIDDEN,       // Parsed, never redrawn (the terminal holds the only copy of the screen)
+} EventSourceVisibility;
+
+// Event loop creation and management (capacity is the initial number of
+// source slots, 0 for the default; the table grows as shells are added)
+EventLoop* event_loop_create(int capacity);
+void event_loop_destroy(EventLoop* loop);
+
+// Source registration (one per Shell, output is parsed into its Terminal).
+// Remove a source (or sync after closing its tab) before shell_destroy: once
+// the master fd is closed the backend can no longer unregister it, and a
+// stale registration would keep reporting events for the freed Shell.
+int event_loop_add_source(EventLoop* loop, Shell* shell, Terminal* terminal);
+int event_loop_remove_source(EventLoop* loop, Shell* shell);
+int event_loop_get_source_count(EventLoop* loop);
+
+// Visibility
+void event_loop_set_visibility(EventLoop* loop, Shell* shell, EventSourceVisibility visibility);
+EventSourceVisibility event_loop_get_visibility(EventLoop* loop, Shell* shell);
+
+// Register every tab's shell, drop sources whose tab was closed and make
+// only the active tab visible. Call it after removing a tab and before
+// destroying that tab's Shell.
+void event_loop_sync_tabs(EventLoop* loop, TabManager* manager);
+
+// Wait up to timeout_ms (0 = don't block, -1 = forever) and dispatch all
+// ready shells to their terminals. Returns bytes parsed, or -1 on error.
+int event_loop_poll(EventLoop* loop, int timeout_ms);
+
+// Poll without blocking until no shell has output left or budget_ms has
+// passed, for draining once per frame. Returns bytes parsed, or -1 on error.
+int event_loop_drain(EventLoop* loop, int budget_ms);
+
+// Rendering: whether a visible tab's terminal changed since the last call.
+// Renderers read the screen straight from the Terminal.
+int event_loop_needs_redraw(EventLoop* loop);
+
+#endif // EVENT_LOOP_H
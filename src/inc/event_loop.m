@@ -0,0 +1,470 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+#define EVENT_LOOP_KQUEUE 1
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/time.h>
+#elif defined(__linux__)
+#define EVENT_LOOP_EPOLL 1
+#include <sys/epoll.h>
+#else
+#define EVENT_LOOP_POLL 1
+#include <poll.h>
+#endif
+
+#include "event_loop.h"
+#include "terminal.h"
+#include "shell.h"
+#include "tabs.h"
+
+#define DEFAULT_SOURCE_CAPACITY 64
+#define READ_CHUNK_SIZE 4096
+#define READ_BUDGET 65536        // Per source per poll, keeps one noisy shell from starving the rest
+#define MAX_EVENTS 64
+
+typedef struct {
+    Shell *shell;
+    Terminal *terminal;
+    int fd;
+    EventSourceVisibility visibility;
+    int is_closed;
+    int is_owned;               // Scratch flag for event_loop_sync_tabs
+} EventSourceData;
+
+typedef struct {
+    EventSourceData **sources;
+    int source_count;
+    int source_capacity;
+    int backend_fd;
+#ifdef EVENT_LOOP_POLL
+    struct pollfd *poll_fds;
+#endif
+    int needs_redraw;
+    int hit_budget;             // Last poll left data unread
+} EventLoopData;
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int find_source_index(EventLoopData *loop_data, Shell *shell) {
+    for (int i = 0; i < loop_data->source_count; i++) {
+        if (loop_data->sources[i]->shell == shell) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Backend registration
+
+static int backend_add(EventLoopData *loop_data, EventSourceData *source) {
+#if defined(EVENT_LOOP_KQUEUE)
+    struct kevent change;
+    EV_SET(&change, source->fd, EVFILT_READ, EV_ADD | EV_ENABLE, 0, 0, source);
+    return kevent(loop_data->backend_fd, &change, 1, NULL, 0, NULL);
+#elif defined(EVENT_LOOP_EPOLL)
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = source;
+    return epoll_ctl(loop_data->backend_fd, EPOLL_CTL_ADD, source->fd, &ev);
+#else
+    (void)loop_data;
+    (void)source;
+    return 0;  // poll() set is rebuilt from the source list
+#endif
+}
+
+static void backend_remove(EventLoopData *loop_data, EventSourceData *source) {
+    if (source->fd < 0) return;
+#if defined(EVENT_LOOP_KQUEUE)
+    struct kevent change;
+    EV_SET(&change, source->fd, EVFILT_READ, EV_DELETE, 0, 0, NULL);
+    kevent(loop_data->backend_fd, &change, 1, NULL, 0, NULL);
+#elif defined(EVENT_LOOP_EPOLL)
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    epoll_ctl(loop_data->backend_fd, EPOLL_CTL_DEL, source->fd, &ev);
+#else
+    (void)loop_data;
+#endif
+}
+
+EventLoop* event_loop_create(int capacity) {
+    if (capacity <= 0) capacity = DEFAULT_SOURCE_CAPACITY;
+    
+    EventLoopData *loop = (EventLoopData *)malloc(sizeof(EventLoopData));
+    if (!loop) return NULL;
+    
+    memset(loop, 0, sizeof(EventLoopData));
+    
+    loop->sources = (EventSourceData **)malloc(sizeof(EventSourceData *) * capacity);
+    if (!loop->sources) {
+        free(loop);
+        return NULL;
+    }
+    memset(loop->sources, 0, sizeof(EventSourceData *) * capacity);
+
+#if defined(EVENT_LOOP_KQUEUE)
+    loop->backend_fd = kqueue();
+#elif defined(EVENT_LOOP_EPOLL)
+    loop->backend_fd = epoll_create1(EPOLL_CLOEXEC);
+#else
+    loop->backend_fd = 0;
+    loop->poll_fds = (struct pollfd *)malloc(sizeof(struct pollfd) * capacity);
+    if (!loop->poll_fds) loop->backend_fd = -1;
+#endif
+
+    if (loop->backend_fd < 0) {
+#ifdef EVENT_LOOP_POLL
+        free(loop->poll_fds);
+#endif
+        free(loop->sources);
+        free(loop);
+        return NULL;
+    }
+    
+    loop->source_capacity = capacity;
+    loop->source_count = 0;
+    loop->needs_redraw = 0;
+    
+    return (EventLoop *)loop;
+}
+
+void event_loop_destroy(EventLoop* loop) {
+    if (!loop) return;
+    
+    EventLoopData *loop_data = (EventLoopData *)loop;
+    
+    // Note: shells and terminals are owned by their tabs/panes
+    for (int i = 0; i < loop_data->source_count; i++) {
+        free(loop_data->sources[i]);
+    }
+
+#if defined(EVENT_LOOP_KQUEUE) || defined(EVENT_LOOP_EPOLL)
+    close(loop_data->backend_fd);
+#else
+    free(loop_data->poll_fds);
+#endif
+
+    free(loop_data->sources);
+    free(loop_data);
+}
+
+static int grow_sources(EventLoopData *loop_data) {
+    int capacity = loop_data->source_capacity * 2;
+    EventSourceData **sources = (EventSourceData **)realloc(loop_data->sources, sizeof(EventSourceData *) * capacity);
+    if (!sources) return -1;
+    loop_data->sources = sources;
+
+#ifdef EVENT_LOOP_POLL
+    struct pollfd *poll_fds = (struct pollfd *)realloc(loop_data->poll_fds, sizeof(struct pollfd) * capacity);
+    if (!poll_fds) return -1;
+    loop_data->poll_fds = poll_fds;
+#endif
+
+    loop_data->source_capacity = capacity;
+    return 0;
+}
+
+static void remove_source_at(EventLoopData *loop_data, int index) {
+    EventSourceData *source = loop_data->sources[index];
+    if (!source->is_closed) {
+        backend_remove(loop_data, source);
+    }
+    free(source);
+    
+    // Shift remaining sources
+    for (int i = index; i < loop_data->source_count - 1; i++) {
+        loop_data->sources[i] = loop_data->sources[i + 1];
+    }
+    
+    loop_data->source_count--;
+}
+
+int event_loop_add_source(EventLoop* loop, Shell* shell, Terminal* terminal) {
+    if (!loop || !shell || !terminal) return -1;
+    
+    EventLoopData *loop_data = (EventLoopData *)loop;
+    
+    int fd = shell_get_master_fd(shell);
+    if (fd < 0) return -1;
+    
+    int index = find_source_index(loop_data, shell);
+    if (index >= 0) {
+        EventSourceData *existing = loop_data->sources[index];
+        if (existing->fd == fd && existing->terminal == terminal) {
+            return 0;  // Already registered
+        }
+        
+        // A new Shell reusing a destroyed one's address
+        remove_source_at(loop_data, index);
+    }
+    
+    if (loop_data->source_count >= loop_data->source_capacity && grow_sources(loop_data) < 0) {
+        return -1;
+    }
+    
+    EventSourceData *source = (EventSourceData *)malloc(sizeof(EventSourceData));
+    if (!source) return -1;
+    
+    memset(source, 0, sizeof(EventSourceData));
+    source->shell = shell;
+    source->terminal = terminal;
+    source->fd = fd;
+    source->visibility = EVENT_SOURCE_BACKGROUND;
+    
+    if (backend_add(loop_data, source) < 0) {
+        free(source);
+        return -1;
+    }
+    
+    loop_data->sources[loop_data->source_count] = source;
+    loop_data->source_count++;
+    
+    return 0;
+}
+
+int event_loop_remove_source(EventLoop* loop, Shell* shell) {
+    if (!loop || !shell) return -1;
+    
+    EventLoopData *loop_data = (EventLoopData *)loop;
+    
+    int index = find_source_index(loop_data, shell);
+    if (index < 0) return -1;
+    
+    remove_source_at(loop_data, index);
+    
+    return 0;
+}
+
+int event_loop_get_source_count(EventLoop* loop) {
+    if (!loop) return 0;
+    
+    EventLoopData *loop_data = (EventLoopData *)loop;
+    return loop_data->source_count;
+}
+
+void event_loop_set_visibility(EventLoop* loop, Shell* shell, EventSourceVisibility visibility) {
+    if (!loop || !shell) return;
+    
+    EventLoopData *loop_data = (EventLoopData *)loop;
+    
+    int index = find_source_index(loop_data, shell);
+    if (index < 0) return;
+    
+    EventSourceData *source = loop_data->sources[index];
+    if (source->visibility == visibility) return;
+    
+    if (visibility == EVENT_SOURCE_VISIBLE) {
+        // Content parsed while in the background has never been drawn
+        loop_data->needs_redraw = 1;
+    }
+    
+    source->visibility = visibility;
+}
+
+EventSourceVisibility event_loop_get_visibility(EventLoop* loop, Shell* shell) {
+    if (!loop || !shell) return EVENT_SOURCE_HIDDEN;
+    
+    EventLoopData *loop_data = (EventLoopData *)loop;
+    
+    int index = find_source_index(loop_data, shell);
+    if (index < 0) return EVENT_SOURCE_HIDDEN;
+    
+    return loop_data->sources[index]->visibility;
+}
+
+void event_loop_sync_tabs(EventLoop* loop, TabManager* manager) {
+    if (!loop || !manager) return;
+    
+    EventLoopData *loop_data = (EventLoopData *)loop;
+    int active_index = tab_manager_get_active_tab_index(manager);
+    int tab_count = tab_manager_get_tab_count(manager);
+    
+    // Drop sources no tab owns any more (their tab was closed). Only the
+    // stored pointers and fd are compared, a closed tab's Shell may be freed.
+    for (int i = 0; i < loop_data->source_count; i++) {
+        loop_data->sources[i]->is_owned = 0;
+    }
+    
+    for (int i = 0; i < tab_count; i++) {
+        Tab *tab = tab_manager_get_tab(manager, i);
+        Shell *shell = tab_get_shell(tab);
+        if (!shell) continue;
+        
+        int index = find_source_index(loop_data, shell);
+        if (index < 0) continue;
+        
+        EventSourceData *source = loop_data->sources[index];
+        if (source->terminal == tab_get_terminal(tab) && source->fd == shell_get_master_fd(shell)) {
+            source->is_owned = 1;
+        }
+    }
+    
+    for (int i = loop_data->source_count - 1; i >= 0; i--) {
+        if (!loop_data->sources[i]->is_owned) {
+            remove_source_at(loop_data, i);
+        }
+    }
+    
+    for (int i = 0; i < tab_count; i++) {
+        Tab *tab = tab_manager_get_tab(manager, i);
+        Shell *shell = tab_get_shell(tab);
+        Terminal *terminal = tab_get_terminal(tab);
+        if (!shell || !terminal) continue;
+        
+        if (event_loop_add_source(loop, shell, terminal) < 0) continue;
+        
+        if (i == active_index) {
+            event_loop_set_visibility(loop, shell, EVENT_SOURCE_VISIBLE);
+        } else if (event_loop_get_visibility(loop, shell) == EVENT_SOURCE_VISIBLE) {
+            event_loop_set_visibility(loop, shell, EVENT_SOURCE_BACKGROUND);
+        }
+    }
+}
+
+// Drain one ready shell into its terminal, returns bytes parsed
+static int dispatch_source(EventLoopData *loop_data, EventSourceData *source, int hangup) {
+    char buffer[READ_CHUNK_SIZE];
+    int total = 0;
+    
+    if (source->is_closed) return 0;
+    
+    while (total < READ_BUDGET) {
+        int n = shell_read_output(source->shell, buffer, sizeof(buffer));
+        if (n < 0) {
+            hangup = 1;
+            break;
+        }
+        if (n == 0) break;
+        
+        terminal_write(source->terminal, buffer, n);
+        total += n;
+    }
+    
+    if (total >= READ_BUDGET) {
+        loop_data->hit_budget = 1;
+    }
+    
+    if (total > 0 && source->visibility == EVENT_SOURCE_VISIBLE) {
+        loop_data->needs_redraw = 1;
+    }
+    
+    // Shell exited: stop watching its fd so it doesn't report readable forever
+    if (hangup && total == 0) {
+        backend_remove(loop_data, source);
+        source->is_closed = 1;
+    }
+    
+    return total;
+}
+
+int event_loop_poll(EventLoop* loop, int timeout_ms) {
+    if (!loop) return -1;
+    
+    EventLoopData *loop_data = (EventLoopData *)loop;
+    int total = 0;
+    
+    loop_data->hit_budget = 0;
+
+#if defined(EVENT_LOOP_KQUEUE)
+    struct kevent events[MAX_EVENTS];
+    struct timespec ts;
+    struct timespec *ts_ptr = NULL;
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000;
+        ts_ptr = &ts;
+    }
+    
+    int count = kevent(loop_data->backend_fd, NULL, 0, events, MAX_EVENTS, ts_ptr);
+    if (count < 0) {
+        return (errno == EINTR) ? 0 : -1;
+    }
+    
+    if (count == MAX_EVENTS) loop_data->hit_budget = 1;
+    
+    for (int i = 0; i < count; i++) {
+        EventSourceData *source = (EventSourceData *)events[i].udata;
+        if (!source) continue;
+        total += dispatch_source(loop_data, source, (events[i].flags & EV_EOF) != 0);
+    }
+#elif defined(EVENT_LOOP_EPOLL)
+    struct epoll_event events[MAX_EVENTS];
+    
+    int count = epoll_wait(loop_data->backend_fd, events, MAX_EVENTS, timeout_ms);
+    if (count < 0) {
+        return (errno == EINTR) ? 0 : -1;
+    }
+    
+    if (count == MAX_EVENTS) loop_data->hit_budget = 1;
+    
+    for (int i = 0; i < count; i++) {
+        EventSourceData *source = (EventSourceData *)events[i].data.ptr;
+        if (!source) continue;
+        total += dispatch_source(loop_data, source, (events[i].events & (EPOLLHUP | EPOLLERR)) != 0);
+    }
+#else
+    int nfds = 0;
+    for (int i = 0; i < loop_data->source_count; i++) {
+        if (loop_data->sources[i]->is_closed) continue;
+        loop_data->poll_fds[nfds].fd = loop_data->sources[i]->fd;
+        loop_data->poll_fds[nfds].events = POLLIN;
+        loop_data->poll_fds[nfds].revents = 0;
+        nfds++;
+    }
+    
+    int count = poll(loop_data->poll_fds, nfds, timeout_ms);
+    if (count < 0) {
+        return (errno == EINTR) ? 0 : -1;
+    }
+    
+    for (int i = 0, j = 0; i < loop_data->source_count && count > 0; i++) {
+        EventSourceData *source = loop_data->sources[i];
+        if (source->is_closed) continue;
+        short revents = loop_data->poll_fds[j++].revents;
+        if (!revents) continue;
+        count--;
+        total += dispatch_source(loop_data, source, (revents & (POLLHUP | POLLERR)) != 0);
+    }
+#endif
+
+    return total;
+}
+
+int event_loop_drain(EventLoop* loop, int budget_ms) {
+    if (!loop) return -1;
+    
+    EventLoopData *loop_data = (EventLoopData *)loop;
+    long long deadline = now_ms() + budget_ms;
+    int total = 0;
+    
+    // Poll again only while the last pass left data unread
+    do {
+        int n = event_loop_poll(loop, 0);
+        if (n < 0) return (total > 0) ? total : -1;
+        total += n;
+    } while (loop_data->hit_budget && now_ms() < deadline);
+    
+    return total;
+}
+
+int event_loop_needs_redraw(EventLoop* loop) {
+    if (!loop) return 0;
+    
+    EventLoopData *loop_data = (EventLoopData *)loop;
+    
+    int needs_redraw = loop_data->needs_redraw;
+    loop_data->needs_redraw = 0;
+    return needs_redraw;
+}
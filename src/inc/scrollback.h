@@ -15,6 +15,7 @@ void scrollback_clear(Scrollback* scrollback);
 const char* scrollback_get_line(Scrollback* scrollback, int line_index);
 int scrollback_get_line_count(Scrollback* scrollback);
 int scrollback_get_max_lines(Scrollback* scrollback);
+long long scrollback_get_lines_added(Scrollback* scrollback);  // Total ever added, including evicted lines
 
 // Search functionality
 int scrollback_search(Scrollback* scrollback, const char* query, int start_from, int search_backward);
@@ -12,9 +12,10 @@ typedef struct {
     int *line_lengths;
     int line_count;
     int max_lines;
-    int current_index;
+    int head;               // Slot of the oldest line, lines wrap around after max_lines
     char *search_query;
     int last_search_index;
+    long long lines_added;
 } ScrollbackData;
 
 Scrollback* scrollback_create(int max_lines) {
@@ -39,7 +40,7 @@ Scrollback* scrollback_create(int max_lines) {
     
     scrollback->search_query = NULL;
     scrollback->line_count = 0;
-    scrollback->current_index = 0;
+    scrollback->head = 0;
     scrollback->last_search_index = -1;
     
     return (Scrollback *)scrollback;
@@ -66,6 +67,13 @@ void scrollback_destroy(Scrollback* scrollback) {
     free(scrollback_data);
 }
 
+// Slot holding the line at line_index (0 is the oldest line)
+static inline int line_slot(ScrollbackData *scrollback, int line_index) {
+    int slot = scrollback->head + line_index;
+    if (slot >= scrollback->max_lines) slot -= scrollback->max_lines;
+    return slot;
+}
+
 void scrollback_add_line(Scrollback* scrollback, const char* line) {
     if (!scrollback || !line) return;
     
@@ -76,32 +84,34 @@ void scrollback_add_line(Scrollback* scrollback, const char* line) {
         line_len = LINE_MAX_LENGTH;
     }
     
-    // If buffer is full, shift all lines
+    int slot;
+    
+    // If buffer is full, the oldest line's slot is reused for the new one
     if (scrollback_data->line_count >= scrollback_data->max_lines) {
-        // Free the oldest line
-        if (scrollback_data->lines[0]) {
-            free(scrollback_data->lines[0]);
-        }
+        slot = scrollback_data->head;
         
-        // Shift all lines down
-        for (int i = 0; i < scrollback_data->max_lines - 1; i++) {
-            scrollback_data->lines[i] = scrollback_data->lines[i + 1];
-            scrollback_data->line_lengths[i] = scrollback_data->line_lengths[i + 1];
+        // Free the oldest line
+        if (scrollback_data->lines[slot]) {
+            free(scrollback_data->lines[slot]);
+            scrollback_data->lines[slot] = NULL;
         }
+        scrollback_data->line_lengths[slot] = 0;
         
-        scrollback_data->current_index = scrollback_data->max_lines - 1;
+        scrollback_data->head = line_slot(scrollback_data, 1);
     } else {
-        scrollback_data->current_index = scrollback_data->line_count;
+        slot = line_slot(scrollback_data, scrollback_data->line_count);
         scrollback_data->line_count++;
     }
     
     // Add new line
-    scrollback_data->lines[scrollback_data->current_index] = (char *)malloc(line_len + 1);
-    if (scrollback_data->lines[scrollback_data->current_index]) {
-        strncpy(scrollback_data->lines[scrollback_data->current_index], line, line_len);
-        scrollback_data->lines[scrollback_data->current_index][line_len] = '\0';
-        scrollback_data->line_lengths[scrollback_data->current_index] = line_len;
+    scrollback_data->lines[slot] = (char *)malloc(line_len + 1);
+    if (scrollback_data->lines[slot]) {
+        memcpy(scrollback_data->lines[slot], line, line_len);
+        scrollback_data->lines[slot][line_len] = '\0';
+        scrollback_data->line_lengths[slot] = line_len;
     }
+    
+    scrollback_data->lines_added++;
 }
 
 void scrollback_clear(Scrollback* scrollback) {
@@ -118,7 +128,7 @@ void scrollback_clear(Scrollback* scrollback) {
     }
     
     scrollback_data->line_count = 0;
-    scrollback_data->current_index = 0;
+    scrollback_data->head = 0;
 }
 
 const char* scrollback_get_line(Scrollback* scrollback, int line_index) {
@@ -130,7 +140,7 @@ const char* scrollback_get_line(Scrollback* scrollback, int line_index) {
         return NULL;
     }
     
-    return scrollback_data->lines[line_index];
+    return scrollback_data->lines[line_slot(scrollback_data, line_index)];
 }
 
 int scrollback_get_line_count(Scrollback* scrollback) {
@@ -147,6 +157,13 @@ int scrollback_get_max_lines(Scrollback* scrollback) {
     return scrollback_data->max_lines;
 }
 
+long long scrollback_get_lines_added(Scrollback* scrollback) {
+    if (!scrollback) return 0;
+    
+    ScrollbackData *scrollback_data = (ScrollbackData *)scrollback;
+    return scrollback_data->lines_added;
+}
+
 // Case-insensitive string search helper
 static int str_search_case_insensitive(const char *haystack, const char *needle) {
     if (!haystack || !needle) return -1;
@@ -189,18 +206,21 @@ int scrollback_search(Scrollback* scrollback, const char* query, int start_from,
     // Search through lines
     if (search_backward) {
         // Search from start_from backwards
+        if (start_from >= scrollback_data->line_count) {
+            start_from = scrollback_data->line_count - 1;
+        }
         for (int i = start_from; i >= 0; i--) {
-            if (scrollback_data->lines[i] && 
-                str_search_case_insensitive(scrollback_data->lines[i], query) >= 0) {
+            const char *line = scrollback_data->lines[line_slot(scrollback_data, i)];
+            if (line && str_search_case_insensitive(line, query) >= 0) {
                 scrollback_data->last_search_index = i;
                 return i;
             }
         }
     } else {
         // Search from start_from forwards
-        for (int i = start_from; i < scrollback_data->line_count; i++) {
-            if (scrollback_data->lines[i] && 
-                str_search_case_insensitive(scrollback_data->lines[i], query) >= 0) {
+        for (int i = (start_from < 0) ? 0 : start_from; i < scrollback_data->line_count; i++) {
+            const char *line = scrollback_data->lines[line_slot(scrollback_data, i)];
+            if (line && str_search_case_insensitive(line, query) >= 0) {
                 scrollback_data->last_search_index = i;
                 return i;
             }
@@ -0,0 +1,37 @@
+#ifndef SESSION_SNAPSHOT_H
+#define SESSION_SNAPSHOT_H
+
+typedef struct SessionSnapshot SessionSnapshot;
+typedef struct SessionSnapshotWriter SessionSnapshotWriter;
+
+// Forward declarations
+typedef struct Terminal Terminal;
+typedef struct TabManager TabManager;
+
+// Snapshot writer (append-only, each save only adds what changed). The file is
+// rewritten once most of it is stale; history of tabs that are neither open nor
+// bound is dropped then, so bind restored tabs before the first save.
+SessionSnapshotWriter* session_snapshot_writer_create(const char* filepath);
+void session_snapshot_writer_destroy(SessionSnapshotWriter* writer);
+int session_snapshot_writer_save(SessionSnapshotWriter* writer, TabManager* manager);
+
+// Continue an existing tab's history (e.g. after restoring it from the same file)
+int session_snapshot_writer_bind(SessionSnapshotWriter* writer, Terminal* terminal, int tab_id);
+
+// Snapshot reader (memory-mapped, contents are only touched when accessed)
+SessionSnapshot* session_snapshot_open(const char* filepath);
+void session_snapshot_close(SessionSnapshot* snapshot);
+
+// Tab layout at the time of the last save
+int session_snapshot_get_tab_count(SessionSnapshot* snapshot);
+int session_snapshot_get_active_tab(SessionSnapshot* snapshot);
+int session_snapshot_get_tab_id(SessionSnapshot* snapshot, int tab_index);
+const char* session_snapshot_get_tab_title(SessionSnapshot* snapshot, int tab_index);
+
+// Tab contents, limited to the most recent max_lines lines (default 10000)
+void session_snapshot_set_max_lines(SessionSnapshot* snapshot, int max_lines);
+int session_snapshot_restore_screen(SessionSnapshot* snapshot, int tab_index, Terminal* terminal);
+int session_snapshot_get_line_count(SessionSnapshot* snapshot, int tab_index);
+const char* session_snapshot_get_line(SessionSnapshot* snapshot, int tab_index, int line_index);
+
+#endif // SESSION_SNAPSHOT_H
@@ -0,0 +1,881 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "session_snapshot.h"
+#include "terminal.h"
+#include "scrollback.h"
+#include "tabs.h"
+
+// File layout (host byte order, every chunk padded to 8 bytes):
+//
+//   header:  "MTRMSNAP" | u32 version | u32 reserved
+//   chunk:   u32 type | u32 tab_id | u64 length | payload[length] | padding
+//
+// Chunks are only ever appended. Per tab the last TAB and SCREEN chunks
+// win and SCROLLBACK chunks concatenate in order; the last LAYOUT chunk
+// lists the tabs that were open. A chunk cut short by a crash ends the file.
+// Once superseded chunks outweigh the current state, the writer rewrites
+// the current state to a new file and renames it over the old one.
+
+#define SNAPSHOT_MAGIC "MTRMSNAP"
+#define SNAPSHOT_MAGIC_SIZE 8
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_HEADER_SIZE 16
+#define CHUNK_HEADER_SIZE 16
+#define MAX_TAB_ID 65535
+#define COMPACT_MIN_SIZE (1 << 20)
+#define DEFAULT_MAX_RESTORED_LINES 10000
+
+#define ALIGN8(n) (((n) + 7) & ~(uint64_t)7)
+
+typedef enum {
+    CHUNK_TAB = 1,          // title '\0'
+    CHUNK_SCREEN = 2,       // i32 width | i32 height | i32 cursor_x | i32 cursor_y | grid[width * height]
+    CHUNK_SCROLLBACK = 3,   // u32 count | u32 offsets[count + 1] | lines, each '\0'-terminated
+    CHUNK_LAYOUT = 4,       // i32 active_index | u32 count | u32 tab_ids[count]
+} ChunkType;
+
+typedef struct {
+    Terminal *terminal;
+    int tab_id;
+    long long saved_lines;      // scrollback_get_lines_added() at the last save
+    uint64_t screen_hash;
+    uint64_t title_hash;
+    int has_screen;
+    int has_title;
+    int seen;
+    
+    // Bytes in the file for this tab, to tell how much of it is still live
+    uint64_t title_bytes;
+    uint64_t screen_bytes;
+    uint64_t line_bytes;
+    long long line_total;
+} TrackedTab;
+
+typedef struct {
+    int fd;
+    char *path;
+    uint64_t file_size;
+    uint64_t live_bytes;        // Estimated size of the current state, as of the last save
+    int needs_rewrite;          // The file may end in a partial chunk, rewrite it on the next save
+    TrackedTab *tabs;
+    int tab_count;
+    int tab_capacity;
+    int next_tab_id;
+    char *buffer;
+    size_t buffer_length;
+    size_t buffer_capacity;
+} SessionSnapshotWriterData;
+
+typedef struct {
+    const char *payload;
+    uint64_t length;
+    int first_line;
+    int line_count;
+} LineChunk;
+
+typedef struct {
+    int exists;
+    const char *title;
+    const char *screen;
+    LineChunk *chunks;
+    int chunk_count;
+    int chunk_capacity;
+    int line_count;
+} SnapshotTab;
+
+typedef struct {
+    char *map;
+    size_t map_size;
+    SnapshotTab *tabs;          // Indexed by tab id
+    int tab_slots;
+    int max_lines;
+    const char *layout;
+    int layout_count;
+    int active_index;
+} SessionSnapshotData;
+
+static uint32_t read_u32(const char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static int32_t read_i32(const char *p) {
+    int32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t read_u64(const char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// FNV-1a, used to skip rewriting screens and titles that haven't changed
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t length) {
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Writer
+
+static int buffer_reserve(SessionSnapshotWriterData *writer, size_t extra) {
+    size_t needed = writer->buffer_length + extra;
+    if (needed <= writer->buffer_capacity) return 0;
+    
+    size_t capacity = writer->buffer_capacity ? writer->buffer_capacity : 65536;
+    while (capacity < needed) capacity *= 2;
+    
+    char *buffer = (char *)realloc(writer->buffer, capacity);
+    if (!buffer) return -1;
+    
+    writer->buffer = buffer;
+    writer->buffer_capacity = capacity;
+    return 0;
+}
+
+static int buffer_append(SessionSnapshotWriterData *writer, const void *data, size_t length) {
+    if (buffer_reserve(writer, length) < 0) return -1;
+    memcpy(writer->buffer + writer->buffer_length, data, length);
+    writer->buffer_length += length;
+    return 0;
+}
+
+static int buffer_append_u32(SessionSnapshotWriterData *writer, uint32_t value) {
+    return buffer_append(writer, &value, sizeof(value));
+}
+
+// Returns the chunk's offset in the buffer, patched by end_chunk()
+static long begin_chunk(SessionSnapshotWriterData *writer, ChunkType type, int tab_id) {
+    long offset = (long)writer->buffer_length;
+    char header[CHUNK_HEADER_SIZE];
+    uint32_t type_value = (uint32_t)type;
+    uint32_t id_value = (uint32_t)tab_id;
+    uint64_t length = 0;
+    
+    memcpy(header, &type_value, 4);
+    memcpy(header + 4, &id_value, 4);
+    memcpy(header + 8, &length, 8);
+    
+    if (buffer_append(writer, header, sizeof(header)) < 0) return -1;
+    return offset;
+}
+
+static int end_chunk(SessionSnapshotWriterData *writer, long offset) {
+    uint64_t length = writer->buffer_length - (size_t)offset - CHUNK_HEADER_SIZE;
+    memcpy(writer->buffer + offset + 8, &length, 8);
+    
+    size_t padding = (size_t)(ALIGN8(writer->buffer_length) - writer->buffer_length);
+    if (padding > 0) {
+        static const char zeros[8] = {0};
+        return buffer_append(writer, zeros, padding);
+    }
+    return 0;
+}
+
+static void fill_header(char *header) {
+    uint32_t version = SNAPSHOT_VERSION;
+    uint32_t reserved = 0;
+    
+    memcpy(header, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE);
+    memcpy(header + 8, &version, 4);
+    memcpy(header + 12, &reserved, 4);
+}
+
+static int write_fully(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        length -= (size_t)n;
+    }
+    return 0;
+}
+
+static TrackedTab* find_tracked(SessionSnapshotWriterData *writer, Terminal *terminal) {
+    for (int i = 0; i < writer->tab_count; i++) {
+        if (writer->tabs[i].terminal == terminal) {
+            return &writer->tabs[i];
+        }
+    }
+    return NULL;
+}
+
+static TrackedTab* add_tracked(SessionSnapshotWriterData *writer, Terminal *terminal, int tab_id) {
+    if (writer->tab_count >= writer->tab_capacity) {
+        int capacity = writer->tab_capacity ? writer->tab_capacity * 2 : 16;
+        TrackedTab *tabs = (TrackedTab *)realloc(writer->tabs, sizeof(TrackedTab) * capacity);
+        if (!tabs) return NULL;
+        writer->tabs = tabs;
+        writer->tab_capacity = capacity;
+    }
+    
+    TrackedTab *tracked = &writer->tabs[writer->tab_count++];
+    memset(tracked, 0, sizeof(TrackedTab));
+    tracked->terminal = terminal;
+    tracked->tab_id = tab_id;
+    
+    if (tab_id >= writer->next_tab_id) {
+        writer->next_tab_id = tab_id + 1;
+    }
+    
+    return tracked;
+}
+
+// Where the chunk at offset ends, padding included, or 0 if the file stops
+// inside it. Reader and writer both end the valid chunks there: the writer
+// truncates the rest, so the reader must never index it.
+static uint64_t chunk_end(uint64_t offset, uint64_t length, uint64_t file_size) {
+    if (length > file_size - offset - CHUNK_HEADER_SIZE) return 0;
+    
+    uint64_t next = ALIGN8(offset + CHUNK_HEADER_SIZE + length);
+    return (next <= file_size) ? next : 0;
+}
+
+// Find where the valid chunks end and the highest tab id in use
+static int scan_existing(int fd, off_t file_size, off_t *out_end, int *out_max_id) {
+    char header[CHUNK_HEADER_SIZE];
+    off_t offset = SNAPSHOT_HEADER_SIZE;
+    int max_id = 0;
+    
+    if (pread(fd, header, SNAPSHOT_HEADER_SIZE, 0) != SNAPSHOT_HEADER_SIZE) return -1;
+    if (memcmp(header, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE) != 0) return -1;
+    if (read_u32(header + 8) != SNAPSHOT_VERSION) return -1;
+    
+    while (offset + CHUNK_HEADER_SIZE <= file_size) {
+        if (pread(fd, header, CHUNK_HEADER_SIZE, offset) != CHUNK_HEADER_SIZE) break;
+        
+        uint64_t next = chunk_end((uint64_t)offset, read_u64(header + 8), (uint64_t)file_size);
+        if (next == 0) break;
+        
+        uint32_t tab_id = read_u32(header + 4);
+        if (tab_id <= MAX_TAB_ID && (int)tab_id > max_id) {
+            max_id = (int)tab_id;
+        }
+        
+        offset = (off_t)next;
+    }
+    
+    *out_end = offset;
+    *out_max_id = max_id;
+    return 0;
+}
+
+SessionSnapshotWriter* session_snapshot_writer_create(const char* filepath) {
+    if (!filepath) return NULL;
+    
+    SessionSnapshotWriterData *writer = (SessionSnapshotWriterData *)malloc(sizeof(SessionSnapshotWriterData));
+    if (!writer) return NULL;
+    
+    memset(writer, 0, sizeof(SessionSnapshotWriterData));
+    writer->next_tab_id = 1;
+    
+    writer->path = strdup(filepath);
+    writer->fd = writer->path ? open(filepath, O_RDWR | O_CREAT, 0600) : -1;
+    if (writer->fd < 0) {
+        free(writer->path);
+        free(writer);
+        return NULL;
+    }
+    
+    struct stat st;
+    off_t end = 0;
+    int max_id = 0;
+    int status = fstat(writer->fd, &st);
+    
+    if (status == 0 && st.st_size == 0) {
+        char header[SNAPSHOT_HEADER_SIZE];
+        fill_header(header);
+        
+        status = write_fully(writer->fd, header, sizeof(header));
+        end = SNAPSHOT_HEADER_SIZE;
+    } else if (status == 0) {
+        // Keep appending to the existing snapshot, dropping any torn tail
+        status = scan_existing(writer->fd, st.st_size, &end, &max_id);
+        if (status == 0 && end < st.st_size) {
+            status = ftruncate(writer->fd, end);
+        }
+        writer->next_tab_id = max_id + 1;
+    }
+    
+    // Only an empty file gets a header: never overwrite what is not a
+    // snapshot of ours (a newer version, a damaged header, some other file)
+    if (status < 0) {
+        close(writer->fd);
+        free(writer->path);
+        free(writer);
+        return NULL;
+    }
+    
+    lseek(writer->fd, end, SEEK_SET);
+    writer->file_size = (uint64_t)end;
+    
+    return (SessionSnapshotWriter *)writer;
+}
+
+void session_snapshot_writer_destroy(SessionSnapshotWriter* writer) {
+    if (!writer) return;
+    
+    SessionSnapshotWriterData *writer_data = (SessionSnapshotWriterData *)writer;
+    
+    close(writer_data->fd);
+    free(writer_data->path);
+    free(writer_data->tabs);
+    free(writer_data->buffer);
+    free(writer_data);
+}
+
+int session_snapshot_writer_bind(SessionSnapshotWriter* writer, Terminal* terminal, int tab_id) {
+    if (!writer || !terminal || tab_id <= 0 || tab_id > MAX_TAB_ID) return -1;
+    
+    SessionSnapshotWriterData *writer_data = (SessionSnapshotWriterData *)writer;
+    
+    TrackedTab *tracked = find_tracked(writer_data, terminal);
+    if (!tracked) {
+        tracked = add_tracked(writer_data, terminal, tab_id);
+        if (!tracked) return -1;
+    }
+    
+    tracked->tab_id = tab_id;
+    
+    // Lines already in the scrollback were restored from this file
+    tracked->saved_lines = scrollback_get_lines_added(terminal_get_scrollback(terminal));
+    
+    return 0;
+}
+
+static int append_title(SessionSnapshotWriterData *writer, TrackedTab *tracked, const char *title) {
+    if (!title) title = "";
+    
+    size_t length = strlen(title) + 1;
+    uint64_t hash = hash_bytes(14695981039346656037ULL, title, length);
+    if (tracked->has_title && hash == tracked->title_hash) return 0;
+    
+    long chunk = begin_chunk(writer, CHUNK_TAB, tracked->tab_id);
+    if (chunk < 0 || buffer_append(writer, title, length) < 0 || end_chunk(writer, chunk) < 0) return -1;
+    
+    tracked->title_hash = hash;
+    tracked->has_title = 1;
+    tracked->title_bytes = writer->buffer_length - (size_t)chunk;
+    return 0;
+}
+
+static int append_screen(SessionSnapshotWriterData *writer, TrackedTab *tracked, Terminal *terminal) {
+    int32_t dims[4];
+    dims[0] = terminal_get_width(terminal);
+    dims[1] = terminal_get_height(terminal);
+    dims[2] = terminal_get_cursor_x(terminal);
+    dims[3] = terminal_get_cursor_y(terminal);
+    
+    const char *text = terminal_get_text(terminal);
+    if (!text || dims[0] <= 0 || dims[1] <= 0) return 0;
+    
+    size_t grid_size = (size_t)dims[0] * dims[1];
+    uint64_t hash = hash_bytes(14695981039346656037ULL, dims, sizeof(dims));
+    hash = hash_bytes(hash, text, grid_size);
+    if (tracked->has_screen && hash == tracked->screen_hash) return 0;
+    
+    long chunk = begin_chunk(writer, CHUNK_SCREEN, tracked->tab_id);
+    if (chunk < 0 ||
+        buffer_append(writer, dims, sizeof(dims)) < 0 ||
+        buffer_append(writer, text, grid_size) < 0 ||
+        end_chunk(writer, chunk) < 0) {
+        return -1;
+    }
+    
+    tracked->screen_hash = hash;
+    tracked->has_screen = 1;
+    tracked->screen_bytes = writer->buffer_length - (size_t)chunk;
+    return 0;
+}
+
+// Append only the scrollback lines added since this tab was last saved
+static int append_scrollback(SessionSnapshotWriterData *writer, TrackedTab *tracked, Terminal *terminal) {
+    Scrollback *scrollback = terminal_get_scrollback(terminal);
+    if (!scrollback) return 0;
+    
+    // Number lines by when they were added: the scrollback holds
+    // [oldest, added), index 0 being the oldest line still in the ring
+    long long added = scrollback_get_lines_added(scrollback);
+    long long oldest = added - scrollback_get_line_count(scrollback);
+    
+    // Lines evicted from a full scrollback before we saw them are gone
+    long long from = (tracked->saved_lines > oldest) ? tracked->saved_lines : oldest;
+    if (from >= added) {
+        tracked->saved_lines = added;
+        return 0;
+    }
+    
+    int first = (int)(from - oldest);
+    uint32_t count = (uint32_t)(added - from);
+    
+    long chunk = begin_chunk(writer, CHUNK_SCROLLBACK, tracked->tab_id);
+    if (chunk < 0 || buffer_append_u32(writer, count) < 0) return -1;
+    
+    size_t offsets_at = writer->buffer_length;
+    if (buffer_reserve(writer, sizeof(uint32_t) * (count + 1)) < 0) return -1;
+    writer->buffer_length += sizeof(uint32_t) * (count + 1);
+    
+    size_t data_at = writer->buffer_length;
+    for (uint32_t i = 0; i < count; i++) {
+        const char *line = scrollback_get_line(scrollback, first + (int)i);
+        if (!line) line = "";
+        
+        uint32_t offset = (uint32_t)(writer->buffer_length - data_at);
+        if (buffer_append(writer, line, strlen(line) + 1) < 0) return -1;
+        memcpy(writer->buffer + offsets_at + sizeof(uint32_t) * i, &offset, sizeof(offset));
+    }
+    
+    uint32_t end = (uint32_t)(writer->buffer_length - data_at);
+    memcpy(writer->buffer + offsets_at + sizeof(uint32_t) * count, &end, sizeof(end));
+    
+    if (end_chunk(writer, chunk) < 0) return -1;
+    
+    tracked->saved_lines = added;
+    tracked->line_bytes += writer->buffer_length - (size_t)chunk;
+    tracked->line_total += count;
+    return 0;
+}
+
+// Estimated bytes a compacted file would need for this tab. Evicted lines
+// are assumed to be as long as the tab's lines on average.
+static uint64_t tracked_live_bytes(TrackedTab *tracked) {
+    uint64_t live = tracked->title_bytes + tracked->screen_bytes;
+    
+    if (tracked->line_total > 0) {
+        long long kept = scrollback_get_line_count(terminal_get_scrollback(tracked->terminal));
+        if (kept > tracked->line_total) kept = tracked->line_total;
+        live += (uint64_t)((double)tracked->line_bytes * kept / tracked->line_total);
+    }
+    
+    return live;
+}
+
+// Nothing of this tab is in the file any more, as far as the next save knows
+static void reset_progress(TrackedTab *tracked) {
+    tracked->saved_lines = 0;
+    tracked->has_title = 0;
+    tracked->has_screen = 0;
+    tracked->title_bytes = 0;
+    tracked->screen_bytes = 0;
+    tracked->line_bytes = 0;
+    tracked->line_total = 0;
+}
+
+// Write the buffer to a new file and move it over the old one
+static int replace_file(SessionSnapshotWriterData *writer) {
+    size_t path_length = strlen(writer->path);
+    char *temp_path = (char *)malloc(path_length + 5);
+    if (!temp_path) return -1;
+    
+    memcpy(temp_path, writer->path, path_length);
+    memcpy(temp_path + path_length, ".tmp", 5);
+    
+    int fd = open(temp_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        free(temp_path);
+        return -1;
+    }
+    
+    if (write_fully(fd, writer->buffer, writer->buffer_length) < 0 ||
+        fsync(fd) < 0 ||
+        rename(temp_path, writer->path) < 0) {
+        close(fd);
+        unlink(temp_path);
+        free(temp_path);
+        return -1;
+    }
+    
+    free(temp_path);
+    close(writer->fd);
+    writer->fd = fd;
+    writer->file_size = writer->buffer_length;
+    writer->needs_rewrite = 0;
+    return 0;
+}
+
+int session_snapshot_writer_save(SessionSnapshotWriter* writer, TabManager* manager) {
+    if (!writer || !manager) return -1;
+    
+    SessionSnapshotWriterData *writer_data = (SessionSnapshotWriterData *)writer;
+    int tab_count = tab_manager_get_tab_count(manager);
+    int result = 0;
+    
+    writer_data->buffer_length = 0;
+    
+    // Superseded screens, evicted lines and closed tabs outweigh the live
+    // state: write every tab out in full to a fresh file instead
+    int compact = writer_data->needs_rewrite ||
+                  (writer_data->file_size > COMPACT_MIN_SIZE &&
+                   writer_data->file_size - writer_data->live_bytes > writer_data->live_bytes);
+    
+    if (compact) {
+        char header[SNAPSHOT_HEADER_SIZE];
+        fill_header(header);
+        result = buffer_append(writer_data, header, sizeof(header));
+        
+        for (int i = 0; i < writer_data->tab_count; i++) {
+            reset_progress(&writer_data->tabs[i]);
+        }
+    }
+    
+    for (int i = 0; i < writer_data->tab_count; i++) {
+        writer_data->tabs[i].seen = 0;
+    }
+    
+    for (int i = 0; i < tab_count && result == 0; i++) {
+        Tab *tab = tab_manager_get_tab(manager, i);
+        Terminal *terminal = tab_get_terminal(tab);
+        if (!terminal) continue;
+        
+        TrackedTab *tracked = find_tracked(writer_data, terminal);
+        if (!tracked) {
+            if (writer_data->next_tab_id > MAX_TAB_ID) {
+                result = -1;
+                break;
+            }
+            tracked = add_tracked(writer_data, terminal, writer_data->next_tab_id);
+            if (!tracked) {
+                result = -1;
+                break;
+            }
+        }
+        tracked->seen = 1;
+        
+        if (append_title(writer_data, tracked, tab_get_title(tab)) < 0 ||
+            append_scrollback(writer_data, tracked, terminal) < 0 ||
+            append_screen(writer_data, tracked, terminal) < 0) {
+            result = -1;
+        }
+    }
+    
+    // Tab order and active tab, written every save
+    uint64_t layout_bytes = 0;
+    if (result == 0) {
+        long chunk = begin_chunk(writer_data, CHUNK_LAYOUT, 0);
+        uint32_t layout_count = 0;
+        size_t count_at;
+        
+        if (chunk < 0 || buffer_append_u32(writer_data, (uint32_t)tab_manager_get_active_tab_index(manager)) < 0) {
+            result = -1;
+        } else {
+            count_at = writer_data->buffer_length;
+            if (buffer_append_u32(writer_data, 0) < 0) result = -1;
+            
+            for (int i = 0; i < tab_count && result == 0; i++) {
+                TrackedTab *tracked = find_tracked(writer_data, tab_get_terminal(tab_manager_get_tab(manager, i)));
+                if (!tracked) continue;
+                if (buffer_append_u32(writer_data, (uint32_t)tracked->tab_id) < 0) result = -1;
+                layout_count++;
+            }
+            
+            if (result == 0) {
+                memcpy(writer_data->buffer + count_at, &layout_count, sizeof(layout_count));
+                result = end_chunk(writer_data, chunk);
+                layout_bytes = writer_data->buffer_length - (size_t)chunk;
+            }
+        }
+    }
+    
+    if (result == 0 && compact) {
+        result = replace_file(writer_data);
+    } else if (result == 0) {
+        off_t start = lseek(writer_data->fd, 0, SEEK_CUR);
+        if (write_fully(writer_data->fd, writer_data->buffer, writer_data->buffer_length) < 0) {
+            if (ftruncate(writer_data->fd, start) < 0) {
+                writer_data->needs_rewrite = 1;
+            }
+            lseek(writer_data->fd, start, SEEK_SET);
+            result = -1;
+        } else {
+            writer_data->file_size += writer_data->buffer_length;
+        }
+    }
+    
+    if (result < 0) {
+        // Tabs keep their ids, but what this save appended to the buffer is
+        // lost: the next save rewrites the file with every tab in full
+        for (int i = 0; i < writer_data->tab_count; i++) {
+            reset_progress(&writer_data->tabs[i]);
+        }
+        writer_data->needs_rewrite = 1;
+        return -1;
+    }
+    
+    // Stop tracking closed tabs, their history is dead from now on
+    int kept = 0;
+    uint64_t live = SNAPSHOT_HEADER_SIZE + layout_bytes;
+    for (int i = 0; i < writer_data->tab_count; i++) {
+        if (writer_data->tabs[i].seen) {
+            live += tracked_live_bytes(&writer_data->tabs[i]);
+            writer_data->tabs[kept++] = writer_data->tabs[i];
+        }
+    }
+    writer_data->tab_count = kept;
+    writer_data->live_bytes = live;
+    
+    return 0;
+}
+
+// Reader
+
+static SnapshotTab* get_tab_slot(SessionSnapshotData *snapshot, uint32_t tab_id) {
+    if (tab_id == 0 || tab_id > MAX_TAB_ID) return NULL;
+    
+    if ((int)tab_id >= snapshot->tab_slots) {
+        int slots = snapshot->tab_slots ? snapshot->tab_slots : 16;
+        while (slots <= (int)tab_id) slots *= 2;
+        
+        SnapshotTab *tabs = (SnapshotTab *)realloc(snapshot->tabs, sizeof(SnapshotTab) * slots);
+        if (!tabs) return NULL;
+        
+        memset(tabs + snapshot->tab_slots, 0, sizeof(SnapshotTab) * (slots - snapshot->tab_slots));
+        snapshot->tabs = tabs;
+        snapshot->tab_slots = slots;
+    }
+    
+    SnapshotTab *tab = &snapshot->tabs[tab_id];
+    tab->exists = 1;
+    return tab;
+}
+
+static void index_chunk(SessionSnapshotData *snapshot, uint32_t type, uint32_t tab_id,
+                        const char *payload, uint64_t length) {
+    switch (type) {
+        case CHUNK_TAB: {
+            if (length == 0 || payload[length - 1] != '\0') return;
+            SnapshotTab *tab = get_tab_slot(snapshot, tab_id);
+            if (tab) tab->title = payload;
+            break;
+        }
+        case CHUNK_SCREEN: {
+            if (length < 16) return;
+            int32_t width = read_i32(payload);
+            int32_t height = read_i32(payload + 4);
+            if (width <= 0 || height <= 0 || (uint64_t)width * (uint64_t)height > length - 16) return;
+            SnapshotTab *tab = get_tab_slot(snapshot, tab_id);
+            if (tab) tab->screen = payload;
+            break;
+        }
+        case CHUNK_SCROLLBACK: {
+            if (length < 4) return;
+            uint32_t count = read_u32(payload);
+            if (count == 0 || ((uint64_t)count + 2) * 4 > length) return;
+            
+            SnapshotTab *tab = get_tab_slot(snapshot, tab_id);
+            if (!tab || tab->line_count > INT_MAX - (int)count) return;
+            
+            if (tab->chunk_count >= tab->chunk_capacity) {
+                int capacity = tab->chunk_capacity ? tab->chunk_capacity * 2 : 16;
+                LineChunk *chunks = (LineChunk *)realloc(tab->chunks, sizeof(LineChunk) * capacity);
+                if (!chunks) return;
+                tab->chunks = chunks;
+                tab->chunk_capacity = capacity;
+            }
+            
+            LineChunk *chunk = &tab->chunks[tab->chunk_count++];
+            chunk->payload = payload;
+            chunk->length = length;
+            chunk->first_line = tab->line_count;
+            chunk->line_count = (int)count;
+            tab->line_count += (int)count;
+            break;
+        }
+        case CHUNK_LAYOUT: {
+            if (length < 8) return;
+            uint32_t count = read_u32(payload + 4);
+            if ((uint64_t)count * 4 > length - 8 || count > MAX_TAB_ID) return;
+            snapshot->layout = payload;
+            snapshot->layout_count = (int)count;
+            snapshot->active_index = read_i32(payload);
+            break;
+        }
+        default:
+            // Unknown chunk types from newer versions are skipped
+            break;
+    }
+}
+
+SessionSnapshot* session_snapshot_open(const char* filepath) {
+    if (!filepath) return NULL;
+    
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) return NULL;
+    
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < SNAPSHOT_HEADER_SIZE) {
+        close(fd);
+        return NULL;
+    }
+    
+    char *map = (char *)mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+    
+    if (memcmp(map, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE) != 0 || read_u32(map + 8) != SNAPSHOT_VERSION) {
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    
+    SessionSnapshotData *snapshot = (SessionSnapshotData *)malloc(sizeof(SessionSnapshotData));
+    if (!snapshot) {
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    
+    memset(snapshot, 0, sizeof(SessionSnapshotData));
+    snapshot->map = map;
+    snapshot->map_size = (size_t)st.st_size;
+    snapshot->active_index = -1;
+    snapshot->max_lines = DEFAULT_MAX_RESTORED_LINES;
+    
+    // Only chunk headers are read here; screen and line data stay on disk until used
+    uint64_t offset = SNAPSHOT_HEADER_SIZE;
+    uint64_t size = snapshot->map_size;
+    
+    while (offset + CHUNK_HEADER_SIZE <= size) {
+        const char *header = map + offset;
+        uint64_t length = read_u64(header + 8);
+        uint64_t next = chunk_end(offset, length, size);
+        if (next == 0) break;
+        
+        index_chunk(snapshot, read_u32(header), read_u32(header + 4), header + CHUNK_HEADER_SIZE, length);
+        
+        offset = next;
+    }
+    
+    return (SessionSnapshot *)snapshot;
+}
+
+void session_snapshot_close(SessionSnapshot* snapshot) {
+    if (!snapshot) return;
+    
+    SessionSnapshotData *snapshot_data = (SessionSnapshotData *)snapshot;
+    
+    for (int i = 0; i < snapshot_data->tab_slots; i++) {
+        free(snapshot_data->tabs[i].chunks);
+    }
+    
+    free(snapshot_data->tabs);
+    munmap(snapshot_data->map, snapshot_data->map_size);
+    free(snapshot_data);
+}
+
+static SnapshotTab* tab_at(SessionSnapshotData *snapshot, int tab_index) {
+    if (!snapshot->layout || tab_index < 0 || tab_index >= snapshot->layout_count) return NULL;
+    
+    uint32_t tab_id = read_u32(snapshot->layout + 8 + 4 * tab_index);
+    if ((int)tab_id >= snapshot->tab_slots || !snapshot->tabs[tab_id].exists) return NULL;
+    
+    return &snapshot->tabs[tab_id];
+}
+
+int session_snapshot_get_tab_count(SessionSnapshot* snapshot) {
+    if (!snapshot) return 0;
+    return ((SessionSnapshotData *)snapshot)->layout_count;
+}
+
+int session_snapshot_get_active_tab(SessionSnapshot* snapshot) {
+    if (!snapshot) return -1;
+    return ((SessionSnapshotData *)snapshot)->active_index;
+}
+
+int session_snapshot_get_tab_id(SessionSnapshot* snapshot, int tab_index) {
+    if (!snapshot) return -1;
+    
+    SessionSnapshotData *snapshot_data = (SessionSnapshotData *)snapshot;
+    if (!snapshot_data->layout || tab_index < 0 || tab_index >= snapshot_data->layout_count) return -1;
+    
+    return (int)read_u32(snapshot_data->layout + 8 + 4 * tab_index);
+}
+
+const char* session_snapshot_get_tab_title(SessionSnapshot* snapshot, int tab_index) {
+    if (!snapshot) return NULL;
+    
+    SnapshotTab *tab = tab_at((SessionSnapshotData *)snapshot, tab_index);
+    return tab ? tab->title : NULL;
+}
+
+int session_snapshot_restore_screen(SessionSnapshot* snapshot, int tab_index, Terminal* terminal) {
+    if (!snapshot || !terminal) return -1;
+    
+    SnapshotTab *tab = tab_at((SessionSnapshotData *)snapshot, tab_index);
+    if (!tab || !tab->screen) return -1;
+    
+    terminal_restore(terminal, tab->screen + 16,
+                     read_i32(tab->screen), read_i32(tab->screen + 4),
+                     read_i32(tab->screen + 8), read_i32(tab->screen + 12));
+    return 0;
+}
+
+void session_snapshot_set_max_lines(SessionSnapshot* snapshot, int max_lines) {
+    if (!snapshot || max_lines <= 0) return;
+    ((SessionSnapshotData *)snapshot)->max_lines = max_lines;
+}
+
+// Only the most recent max_lines of a tab's history are restored
+static int visible_line_count(SessionSnapshotData *snapshot, SnapshotTab *tab) {
+    return (tab->line_count < snapshot->max_lines) ? tab->line_count : snapshot->max_lines;
+}
+
+int session_snapshot_get_line_count(SessionSnapshot* snapshot, int tab_index) {
+    if (!snapshot) return 0;
+    
+    SessionSnapshotData *snapshot_data = (SessionSnapshotData *)snapshot;
+    SnapshotTab *tab = tab_at(snapshot_data, tab_index);
+    return tab ? visible_line_count(snapshot_data, tab) : 0;
+}
+
+const char* session_snapshot_get_line(SessionSnapshot* snapshot, int tab_index, int line_index) {
+    if (!snapshot || line_index < 0) return NULL;
+    
+    SessionSnapshotData *snapshot_data = (SessionSnapshotData *)snapshot;
+    SnapshotTab *tab = tab_at(snapshot_data, tab_index);
+    if (!tab) return NULL;
+    
+    int visible = visible_line_count(snapshot_data, tab);
+    if (line_index >= visible) return NULL;
+    line_index += tab->line_count - visible;
+    
+    // Binary search for the chunk holding this line
+    int lo = 0;
+    int hi = tab->chunk_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (tab->chunks[mid].first_line <= line_index) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    
+    LineChunk *chunk = &tab->chunks[lo];
+    uint32_t index = (uint32_t)(line_index - chunk->first_line);
+    uint64_t data_at = 4 + ((uint64_t)chunk->line_count + 1) * 4;
+    uint32_t start = read_u32(chunk->payload + 4 + 4 * index);
+    uint32_t end = read_u32(chunk->payload + 4 + 4 * (index + 1));
+    
+    if (start >= end || end > chunk->length - data_at) return NULL;
+    
+    const char *data = chunk->payload + data_at;
+    if (data[end - 1] != '\0') return NULL;
+    
+    return data + start;
+}
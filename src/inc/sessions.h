@@ -4,6 +4,11 @@
 typedef struct Session Session;
 typedef struct SessionManager SessionManager;
 
+// Forward declarations
+typedef struct SessionSnapshot SessionSnapshot;
+typedef struct Terminal Terminal;
+typedef struct TabManager TabManager;
+
 // Session configuration
 typedef struct {
     char shell_path[256];
@@ -44,4 +49,9 @@ void session_manager_enable_autosave(SessionManager* manager, int enable);
 int session_manager_get_autosave_enabled(SessionManager* manager);
 void session_manager_set_autosave_interval(SessionManager* manager, int seconds);
 
+// Autosave of tab contents (screen, cursor and scrollback) to a binary snapshot
+int session_manager_autosave(SessionManager* manager, TabManager* tabs);
+SessionSnapshot* session_manager_open_autosave(SessionManager* manager);
+int session_manager_adopt_restored_tab(SessionManager* manager, Terminal* terminal, int tab_id);
+
 #endif // SESSIONS_H
@@ -4,6 +4,9 @@
 #include <string.h>
 #include <time.h>
 #include "sessions.h"
+#include "session_snapshot.h"
+
+#define AUTOSAVE_FILENAME "autosave.mtsnap"
 
 typedef struct {
     char name[256];
@@ -23,6 +26,7 @@ typedef struct {
     int autosave_enabled;
     int autosave_interval;
     time_t last_autosave;
+    SessionSnapshotWriter *autosave_writer;
 } SessionManagerData;
 
 Session* session_create(const char* name) {
@@ -221,6 +225,12 @@ SessionManager* session_manager_create(const char* sessions_dir) {
 
 void session_manager_destroy(SessionManager* manager) {
     if (!manager) return;
+    
+    SessionManagerData *manager_data = (SessionManagerData *)manager;
+    if (manager_data->autosave_writer) {
+        session_snapshot_writer_destroy(manager_data->autosave_writer);
+    }
+    
     free(manager);
 }
 
@@ -319,3 +329,57 @@ void session_manager_set_autosave_interval(SessionManager* manager, int seconds)
     SessionManagerData *manager_data = (SessionManagerData *)manager;
     manager_data->autosave_interval = seconds;
 }
+
+static void get_autosave_path(SessionManagerData *manager_data, char *path, size_t path_size) {
+    snprintf(path, path_size, "%s/%s", manager_data->sessions_dir, AUTOSAVE_FILENAME);
+}
+
+static SessionSnapshotWriter* get_autosave_writer(SessionManagerData *manager_data) {
+    if (!manager_data->autosave_writer) {
+        char path[1280];
+        get_autosave_path(manager_data, path, sizeof(path));
+        manager_data->autosave_writer = session_snapshot_writer_create(path);
+    }
+    return manager_data->autosave_writer;
+}
+
+int session_manager_autosave(SessionManager* manager, TabManager* tabs) {
+    if (!manager || !tabs) return -1;
+    
+    SessionManagerData *manager_data = (SessionManagerData *)manager;
+    
+    if (!manager_data->autosave_enabled) return 0;
+    
+    time_t now = time(NULL);
+    if (now - manager_data->last_autosave < manager_data->autosave_interval) {
+        return 0;
+    }
+    
+    // Only screens that changed and scrollback added since the last autosave are written
+    SessionSnapshotWriter *writer = get_autosave_writer(manager_data);
+    if (!writer || session_snapshot_writer_save(writer, tabs) < 0) {
+        return -1;
+    }
+    
+    manager_data->last_autosave = now;
+    return 1;
+}
+
+SessionSnapshot* session_manager_open_autosave(SessionManager* manager) {
+    if (!manager) return NULL;
+    
+    SessionManagerData *manager_data = (SessionManagerData *)manager;
+    
+    char path[1280];
+    get_autosave_path(manager_data, path, sizeof(path));
+    return session_snapshot_open(path);
+}
+
+int session_manager_adopt_restored_tab(SessionManager* manager, Terminal* terminal, int tab_id) {
+    if (!manager || !terminal) return -1;
+    
+    SessionSnapshotWriter *writer = get_autosave_writer((SessionManagerData *)manager);
+    if (!writer) return -1;
+    
+    return session_snapshot_writer_bind(writer, terminal, tab_id);
+}
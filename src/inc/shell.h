@@ -17,6 +17,9 @@ int shell_init_pty(Shell* shell);
 int shell_read_output(Shell* shell, char* buffer, int buffer_size);
 int shell_write_input(Shell* shell, const char* input, int length);
 
+// PTY master file descriptor (for registering with an event loop), -1 if none
+int shell_get_master_fd(Shell* shell);
+
 // PTY resize
 void shell_resize_pty(Shell* shell, int cols, int rows);
 
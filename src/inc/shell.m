@@ -95,6 +95,11 @@ int shell_init_pty(Shell* shell) {
     int flags = fcntl(shell_data->master_fd, F_GETFL);
     fcntl(shell_data->master_fd, F_SETFL, flags | O_NONBLOCK);
     
+    // Keep both ends out of shells started later, or their children hold
+    // this PTY open after shell_destroy
+    fcntl(shell_data->master_fd, F_SETFD, FD_CLOEXEC);
+    fcntl(shell_data->slave_fd, F_SETFD, FD_CLOEXEC);
+    
     // Fork and exec shell
     shell_data->child_pid = fork();
     if (shell_data->child_pid < 0) {
@@ -183,6 +188,13 @@ int shell_write_input(Shell* shell, const char* input, int length) {
     return n;
 }
 
+int shell_get_master_fd(Shell* shell) {
+    if (!shell) return -1;
+    
+    ShellData *shell_data = (ShellData *)shell;
+    return shell_data->master_fd;
+}
+
 int shell_execute_command(Shell* shell, const char* command) {
     if (!shell || !command) return -1;
     
@@ -2,6 +2,8 @@
 #define TERMINAL_H
 
 typedef struct Terminal Terminal;
+typedef struct Scrollback Scrollback;
+typedef struct TriggerEngine TriggerEngine;
 
 // Terminal creation and management
 Terminal* terminal_create(int width, int height);
@@ -25,4 +27,16 @@ void terminal_resize(Terminal* terminal, int width, int height);
 // Clear terminal
 void terminal_clear(Terminal* terminal);
 
+// Replace screen contents and cursor (e.g. from a saved session).
+// A grid of another size is cropped or padded, the terminal keeps its size.
+void terminal_restore(Terminal* terminal, const char* text, int width, int height, int cursor_x, int cursor_y);
+
+// Scrollback (lines scrolled off the top are added to it, not owned)
+void terminal_set_scrollback(Terminal* terminal, Scrollback* scrollback);
+Scrollback* terminal_get_scrollback(Terminal* terminal);
+
+// Output triggers (not owned). Each output line is matched once, soft wraps
+// included: when it ends, and while it is unfinished (e.g. a prompt).
+void terminal_set_trigger_engine(Terminal* terminal, TriggerEngine* triggers);
+
 #endif // TERMINAL_H
@@ -3,6 +3,11 @@
 #include <string.h>
 #include <ctype.h>
 #import "terminal.h"
+#import "scrollback.h"
+#import "triggers.h"
+
+#define MAX_LINE_LENGTH 65536           // Longer output lines are matched on their start
+#define MAX_PARTIAL_LINE_LENGTH 1024    // Unfinished lines are matched up to this long (prompts)
 
 typedef struct {
     char *buffer;
@@ -12,8 +17,135 @@ typedef struct {
     int cursor_y;
     int scroll_pos;
     int buffer_size;
+    Scrollback *scrollback;
+    TriggerEngine *triggers;
+    
+    // Line being written, for triggers. It is read back from the screen when
+    // it ends (soft wraps joined), so writing a character costs nothing extra.
+    int line_row;           // Screen row and column the line starts at
+    int line_col;
+    int line_tracking;      // Triggers are registered, set per write
+    int line_id;            // Trigger engine id once queued unfinished, 0 before
+    char *line;             // Rows that scrolled off, then the copied line
+    int line_length;        // Bytes of scrolled-off rows in line
+    int line_capacity;
 } TerminalData;
 
+static int terminal_line_reserve(TerminalData *term, int capacity) {
+    if (capacity <= term->line_capacity) return 0;
+    
+    int new_capacity = term->line_capacity ? term->line_capacity : 256;
+    while (new_capacity < capacity) new_capacity *= 2;
+    
+    char *line = (char *)realloc(term->line, new_capacity);
+    if (!line) return -1;
+    term->line = line;
+    term->line_capacity = new_capacity;
+    return 0;
+}
+
+// Length of the line from its start to the cursor, not counting scrolled-off rows
+static int terminal_line_span(TerminalData *term) {
+    return (term->cursor_y - term->line_row) * term->width + term->cursor_x - term->line_col;
+}
+
+// The line's text: straight from the screen (rows are contiguous) unless
+// rows of it scrolled off, then copied after them. The last row runs to the
+// cursor or its last character, whichever is further; trailing spaces before
+// the cursor are kept, prompt patterns often end in one.
+static const char* terminal_line_text(TerminalData *term, int *out_length) {
+    const char *start = term->buffer + term->line_row * term->width + term->line_col;
+    const char *row = term->buffer + term->cursor_y * term->width;
+    int end = term->width;
+    while (end > term->cursor_x && row[end - 1] == ' ') end--;
+    
+    int span = (int)(row + end - start);
+    if (span < 0) span = 0;
+    
+    if (term->line_length == 0) {
+        *out_length = span;
+        return start;
+    }
+    
+    if (terminal_line_reserve(term, term->line_length + span) < 0) span = 0;
+    memcpy(term->line + term->line_length, start, span);
+    *out_length = term->line_length + span;
+    return term->line;
+}
+
+static void terminal_queue_line(TerminalData *term, int finished) {
+    int length;
+    const char *text = terminal_line_text(term, &length);
+    
+    if (term->line_id) {
+        trigger_engine_update_line(term->triggers, term->line_id, text, length, finished);
+    } else if (finished) {
+        trigger_engine_queue_line(term->triggers, text, length);
+    } else {
+        term->line_id = trigger_engine_update_line(term->triggers, 0, text, length, 0);
+    }
+}
+
+// A new line starts at the cursor
+static void terminal_start_line(TerminalData *term) {
+    term->line_row = term->cursor_y;
+    term->line_col = term->cursor_x;
+    term->line_length = 0;
+    term->line_id = 0;
+}
+
+// The line ended (newline, cleared screen, cursor moved to another row)
+static void terminal_end_line(TerminalData *term) {
+    if (term->line_tracking && term->triggers) {
+        terminal_queue_line(term, 1);
+    }
+    term->line_length = 0;
+    term->line_id = 0;
+}
+
+// Hand queued lines to the trigger thread, once per write rather than per line
+static void terminal_publish_lines(TerminalData *term) {
+    if (term->line_tracking && term->triggers) {
+        trigger_engine_publish(term->triggers);
+    }
+}
+
+static int terminal_wants_lines(TerminalData *term) {
+    return term->triggers && trigger_engine_get_trigger_count(term->triggers) > 0;
+}
+
+// Scroll the screen up by one line, moving the top line into scrollback
+static void terminal_scroll_up(TerminalData *term) {
+    if (term->scrollback) {
+        char line[term->width + 1];
+        int len = term->width;
+        
+        memcpy(line, term->buffer, term->width);
+        while (len > 0 && line[len - 1] == ' ') len--;
+        line[len] = '\0';
+        
+        scrollback_add_line(term->scrollback, line);
+    }
+    
+    // The line's first row is about to leave the screen: keep it
+    if (term->line_row > 0) {
+        term->line_row--;
+    } else {
+        int span = term->width - term->line_col;
+        if (term->line_tracking && term->line_length + span <= MAX_LINE_LENGTH &&
+            terminal_line_reserve(term, term->line_length + span) == 0) {
+            memcpy(term->line + term->line_length, term->buffer + term->line_col, span);
+            term->line_length += span;
+        }
+        term->line_col = 0;
+    }
+    
+    memmove(term->buffer, term->buffer + term->width, 
+            term->width * (term->height - 1));
+    memset(term->buffer + term->width * (term->height - 1), ' ', term->width);
+    term->cursor_y = term->height - 1;
+}
+
 Terminal* terminal_create(int width, int height) {
     TerminalData *term = (TerminalData *)malloc(sizeof(TerminalData));
     if (!term) return NULL;
@@ -42,6 +174,7 @@ void terminal_destroy(Terminal* terminal) {
     if (term->buffer) {
         free(term->buffer);
     }
+    free(term->line);
     free(terminal);
 }
 
@@ -49,23 +182,22 @@ void terminal_write(Terminal* terminal, const char* data, int length) {
     if (!terminal || !data || length <= 0) return;
     
     TerminalData *term = (TerminalData *)terminal;
+    term->line_tracking = terminal_wants_lines(term);
     
     for (int i = 0; i < length; i++) {
         char c = data[i];
         
         if (c == '\n') {
             // Newline - move to next line
+            terminal_end_line(term);
             term->cursor_x = 0;
             term->cursor_y++;
             
             // Scroll if needed
             if (term->cursor_y >= term->height) {
-                // Scroll up by one line
-                memmove(term->buffer, term->buffer + term->width, 
-                        term->width * (term->height - 1));
-                memset(term->buffer + term->width * (term->height - 1), ' ', term->width);
-                term->cursor_y = term->height - 1;
+                terminal_scroll_up(term);
             }
+            terminal_start_line(term);
         } else if (c == '\r') {
             // Carriage return
             term->cursor_x = 0;
@@ -76,10 +208,7 @@ void terminal_write(Terminal* terminal, const char* data, int length) {
                 term->cursor_x = 0;
                 term->cursor_y++;
                 if (term->cursor_y >= term->height) {
-                    memmove(term->buffer, term->buffer + term->width, 
-                            term->width * (term->height - 1));
-                    memset(term->buffer + term->width * (term->height - 1), ' ', term->width);
-                    term->cursor_y = term->height - 1;
+                    terminal_scroll_up(term);
                 }
             }
         } else if (c == '\b' || c == 127) {
@@ -119,16 +248,22 @@ void terminal_write(Terminal* terminal, const char* data, int length) {
                     switch (cmd) {
                         case 'H':  // Cursor home/move
                         case 'f':
+                            terminal_end_line(term);
                             term->cursor_x = 0;
                             term->cursor_y = 0;
+                            terminal_start_line(term);
                             break;
                         case 'A':  // Cursor up
+                            terminal_end_line(term);
                             if (param == 0) param = 1;
                             term->cursor_y = (term->cursor_y - param < 0) ? 0 : term->cursor_y - param;
+                            terminal_start_line(term);
                             break;
                         case 'B':  // Cursor down
+                            terminal_end_line(term);
                             if (param == 0) param = 1;
                             term->cursor_y = (term->cursor_y + param >= term->height) ? term->height - 1 : term->cursor_y + param;
+                            terminal_start_line(term);
                             break;
                         case 'C':  // Cursor forward (right)
                             if (param == 0) param = 1;
@@ -140,9 +275,11 @@ void terminal_write(Terminal* terminal, const char* data, int length) {
                             break;
                         case 'J':  // Clear display
                             if (param == 2) {
+                                terminal_end_line(term);
                                 memset(term->buffer, ' ', term->buffer_size);
                                 term->cursor_x = 0;
                                 term->cursor_y = 0;
+                                terminal_start_line(term);
                             }
                             break;
                         case 'K':  // Clear line
@@ -166,25 +303,29 @@ void terminal_write(Terminal* terminal, const char* data, int length) {
         } else if (isprint(c)) {
             // Printable character
             int pos = term->cursor_y * term->width + term->cursor_x;
-            if (pos < (int)sizeof(term->buffer)) {
+            if (pos < term->buffer_size) {
                 term->buffer[pos] = c;
             }
             
             term->cursor_x++;
             if (term->cursor_x >= term->width) {
+                // Soft wrap, the line continues on the next row
                 term->cursor_x = 0;
                 term->cursor_y++;
                 
                 // Scroll if needed
                 if (term->cursor_y >= term->height) {
-                    memmove(term->buffer, term->buffer + term->width, 
-                            term->width * (term->height - 1));
-                    memset(term->buffer + term->width * (term->height - 1), ' ', term->width);
-                    term->cursor_y = term->height - 1;
+                    terminal_scroll_up(term);
                 }
             }
         }
     }
+    
+    // Match an unfinished last line too, so prompts fire before any newline
+    if (term->line_tracking && term->line_length + terminal_line_span(term) <= MAX_PARTIAL_LINE_LENGTH) {
+        terminal_queue_line(term, 0);
+    }
+    terminal_publish_lines(term);
 }
 
 const char* terminal_get_text(Terminal* terminal) {
@@ -208,9 +349,12 @@ int terminal_get_cursor_y(Terminal* terminal) {
 void terminal_clear(Terminal* terminal) {
     if (!terminal) return;
     TerminalData *term = (TerminalData *)terminal;
+    terminal_end_line(term);
+    terminal_publish_lines(term);
     memset(term->buffer, ' ', term->buffer_size);
     term->cursor_x = 0;
     term->cursor_y = 0;
+    terminal_start_line(term);
 }
 
 int terminal_get_width(Terminal* terminal) {
@@ -250,6 +394,10 @@ void terminal_resize(Terminal* terminal, int width, int height) {
                copy_cols);
     }
     
+    // Row offsets within the current line no longer hold
+    terminal_end_line(term);
+    terminal_publish_lines(term);
+    
     // Free old buffer and update
     free(term->buffer);
     term->buffer = new_buffer;
@@ -260,4 +408,58 @@ void terminal_resize(Terminal* terminal, int width, int height) {
     // Adjust cursor position if needed
     if (term->cursor_x >= width) term->cursor_x = width - 1;
     if (term->cursor_y >= height) term->cursor_y = height - 1;
+    terminal_start_line(term);
+}
+
+void terminal_restore(Terminal* terminal, const char* text, int width, int height, int cursor_x, int cursor_y) {
+    if (!terminal || !text || width <= 0 || height <= 0) return;
+    
+    TerminalData *term = (TerminalData *)terminal;
+    
+    // The grid stays at its current size (it matches the PTY and window),
+    // the saved one is cropped or padded into it. If it was taller, skip
+    // just enough rows at the top to keep the cursor row visible.
+    int first_row = 0;
+    if (cursor_y >= term->height) {
+        first_row = cursor_y - term->height + 1;
+    }
+    
+    int copy_rows = (height - first_row < term->height) ? height - first_row : term->height;
+    int copy_cols = (width < term->width) ? width : term->width;
+    
+    terminal_end_line(term);
+    terminal_publish_lines(term);
+    memset(term->buffer, ' ', term->buffer_size);
+    for (int row = 0; row < copy_rows; row++) {
+        memcpy(term->buffer + row * term->width,
+               text + (first_row + row) * width,
+               copy_cols);
+    }
+    
+    cursor_y -= first_row;
+    term->cursor_x = (cursor_x < 0) ? 0 : (cursor_x >= term->width) ? term->width - 1 : cursor_x;
+    term->cursor_y = (cursor_y < 0) ? 0 : (cursor_y >= term->height) ? term->height - 1 : cursor_y;
+    terminal_start_line(term);
+}
+
+void terminal_set_scrollback(Terminal* terminal, Scrollback* scrollback) {
+    if (!terminal) return;
+    TerminalData *term = (TerminalData *)terminal;
+    term->scrollback = scrollback;
+}
+
+Scrollback* terminal_get_scrollback(Terminal* terminal) {
+    if (!terminal) return NULL;
+    TerminalData *term = (TerminalData *)terminal;
+    return term->scrollback;
+}
+
+void terminal_set_trigger_engine(Terminal* terminal, TriggerEngine* triggers) {
+    if (!terminal) return;
+    TerminalData *term = (TerminalData *)terminal;
+    terminal_end_line(term);
+    terminal_publish_lines(term);
+    term->triggers = triggers;
+    term->line_tracking = terminal_wants_lines(term);
+    terminal_start_line(term);
 }
@@ -0,0 +1,45 @@
+#ifndef TRIGGERS_H
+#define TRIGGERS_H
+
+typedef struct TriggerEngine TriggerEngine;
+
+// Forward declarations
+typedef struct ScriptingEngine ScriptingEngine;
+
+// Trigger engine creation (matched events are delivered to the scripting engine)
+TriggerEngine* trigger_engine_create(ScriptingEngine* scripting);
+void trigger_engine_destroy(TriggerEngine* engine);
+
+// Trigger management, returns a trigger id or -1
+int trigger_engine_add_trigger(TriggerEngine* engine, const char* pattern, const char* event_name);
+int trigger_engine_remove_trigger(TriggerEngine* engine, int trigger_id);
+int trigger_engine_get_trigger_count(TriggerEngine* engine);
+void trigger_engine_clear(TriggerEngine* engine);
+
+// Case sensitivity (default: case sensitive)
+void trigger_engine_set_case_sensitive(TriggerEngine* engine, int case_sensitive);
+int trigger_engine_get_case_sensitive(TriggerEngine* engine);
+
+// Queue one finished line to be matched against all triggers on the trigger
+// thread. Called on the parse thread; returns the line's id, or 0 if dropped.
+// Queued lines reach the trigger thread at the next trigger_engine_publish.
+int trigger_engine_queue_line(TriggerEngine* engine, const char* line, int length);
+
+// Queue a version of a line that is still being written (a prompt, a
+// progress line rewritten after \r); line_id 0 starts a new line. Each
+// trigger fires at most once per line over all its versions, the last one
+// is queued with finished set. Returns line_id, or 0 if dropped.
+int trigger_engine_update_line(TriggerEngine* engine, int line_id, const char* line, int length, int finished);
+
+// Hand the lines queued since the last call to the trigger thread, once per
+// batch of lines (a read from the shell) rather than once per line
+void trigger_engine_publish(TriggerEngine* engine);
+
+// Block until every published line has been matched and its events delivered
+void trigger_engine_flush(TriggerEngine* engine);
+
+// Statistics
+long long trigger_engine_get_match_count(TriggerEngine* engine);
+long long trigger_engine_get_dropped_count(TriggerEngine* engine);
+
+#endif // TRIGGERS_H
@@ -0,0 +1,902 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include "triggers.h"
+#include "scripting.h"
+
+#define INITIAL_TRIGGER_CAPACITY 16
+#define MAX_PENDING_EVENTS 256
+#define MAX_SKIP_WINDOW 64
+#define SKIP_TABLE_BITS 15
+#define SKIP_TABLE_SIZE (1 << SKIP_TABLE_BITS)
+#define LINE_QUEUE_SIZE (1 << 20)
+#define BATCH_DELAY_MS 5
+#define MAX_OPEN_LINES 64           // Unfinished lines remembered, the oldest is forgotten first
+#define LINE_RECORD_OPEN 0x80000000u
+
+typedef struct {
+    int id;
+    char *pattern;
+    int pattern_length;
+    char *event_name;
+    long long last_hit_line;    // Fire at most once per line
+} TriggerData;
+
+typedef struct {
+    char *event_name;
+    char *line;
+} PendingEvent;
+
+// Header of each queued line; an update of an unfinished line keeps its id
+typedef struct {
+    uint32_t length;            // LINE_RECORD_OPEN set while more versions may follow
+    uint32_t line_id;
+} LineRecord;
+
+// A line queued unfinished, and the triggers that already fired for it
+typedef struct {
+    int line_id;
+    int *fired;                 // Trigger ids
+    int fired_count;
+    int fired_capacity;
+} OpenLine;
+
+enum {
+    WAIT_NONE,
+    WAIT_FOR_LINES,             // Queue empty, wake on the next line
+    WAIT_FOR_BATCH,             // Gathering lines, wake only if the queue fills up
+};
+
+// The parse thread only copies each line into a ring buffer; the trigger
+// thread does the matching and calls into the scripting engine.
+//
+// All patterns are compiled into one Aho-Corasick automaton with a full
+// transition table over byte classes, so scanning costs one table lookup
+// per byte no matter how many triggers are registered. Lines are first
+// checked with a Wu-Manber style skip table over hashed byte triples, which
+// only looks at about one byte in (shortest pattern - 2); the automaton
+// only runs at candidate positions, and only while a match is still possible.
+typedef struct {
+    ScriptingEngine *scripting;
+    
+    TriggerData *triggers;
+    int trigger_count;
+    int trigger_capacity;
+    int next_id;
+    int case_sensitive;
+    
+    // Automaton, rebuilt on the next scan after triggers change
+    int dirty;
+    unsigned char byte_class[256];
+    int class_count;
+    int class_shift;            // Rows are 1 << class_shift entries wide
+    int state_count;
+    int *delta;                 // Transitions, encoded as (next_state << class_shift) << 1 | has_output
+    int *fail;
+    int *depth;                 // Length of the pattern prefix each state represents
+    int *report;                // Nearest state on the fail chain with output (itself included), 0 if none
+    int *out_first;             // First trigger ending at this state, -1 if none
+    int *out_next;              // Next trigger ending at the same state, -1 if none
+    long long record_serial;
+    
+    // Unfinished lines, so each trigger fires once per line across its versions
+    OpenLine *open_lines;
+    int open_line_count;
+    int open_line_capacity;
+    OpenLine *current_line;     // Open line being matched, NULL for a finished one
+    
+    // Prefilter: how far the scan window may move for each byte triple
+    unsigned char fold[256];
+    unsigned char skip[SKIP_TABLE_SIZE];
+    int skip_window;            // 0 when patterns are too short to skip over
+    
+    // Lines waiting to be matched, as 8-byte aligned [LineRecord][bytes] records.
+    // Only the parse thread moves head and only the trigger thread moves tail.
+    // Records past head up to staged are written but not yet published.
+    char *queue;
+    size_t queue_head;
+    size_t queue_tail;
+    size_t queue_staged;        // Parse thread only
+    int next_line_id;           // Parse thread only
+    char *wrapped_line;         // Copy of a record that wraps around the end of the queue
+    int wrapped_capacity;
+    
+    // The mutex guards the triggers and automaton; the trigger thread holds it while matching
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t has_lines;
+    pthread_cond_t idle;
+    int waiting;                // One of the WAIT_ states below
+    int flush_requests;
+    int is_delivering;
+    int stopping;
+    
+    // Matches from the current batch, delivered once the mutex is released
+    PendingEvent *pending;
+    int pending_count;
+    int pending_capacity;
+    
+    long long match_count;
+    long long dropped_count;
+} TriggerEngineData;
+
+static void free_automaton(TriggerEngineData *engine) {
+    free(engine->delta);
+    free(engine->fail);
+    free(engine->depth);
+    free(engine->report);
+    free(engine->out_first);
+    free(engine->out_next);
+    
+    engine->delta = NULL;
+    engine->fail = NULL;
+    engine->depth = NULL;
+    engine->report = NULL;
+    engine->out_first = NULL;
+    engine->out_next = NULL;
+    engine->state_count = 0;
+}
+
+// Multiplicative hash of three folded bytes into the skip table
+static inline int skip_key(const unsigned char *fold, const unsigned char *p) {
+    uint32_t v = ((uint32_t)fold[p[0]] << 16) | ((uint32_t)fold[p[1]] << 8) | fold[p[2]];
+    return (int)((v * 2654435761u) >> (32 - SKIP_TABLE_BITS));
+}
+
+static void build_filter(TriggerEngineData *engine) {
+    for (int c = 0; c < 256; c++) {
+        engine->fold[c] = (unsigned char)(engine->case_sensitive ? c : tolower(c));
+    }
+    
+    // The window is the shortest pattern, only its prefix of that length is used
+    int window = MAX_SKIP_WINDOW;
+    for (int i = 0; i < engine->trigger_count; i++) {
+        if (engine->triggers[i].pattern_length < window) {
+            window = engine->triggers[i].pattern_length;
+        }
+    }
+    
+    if (window < 4) {
+        engine->skip_window = 0;
+        return;
+    }
+    
+    memset(engine->skip, window - 2, sizeof(engine->skip));
+    
+    for (int i = 0; i < engine->trigger_count; i++) {
+        const unsigned char *pattern = (const unsigned char *)engine->triggers[i].pattern;
+        for (int q = 2; q < window; q++) {
+            int key = skip_key(engine->fold, pattern + q - 2);
+            if (engine->skip[key] > window - 1 - q) {
+                engine->skip[key] = (unsigned char)(window - 1 - q);
+            }
+        }
+    }
+    
+    engine->skip_window = window;
+}
+
+static int build_automaton(TriggerEngineData *engine) {
+    free_automaton(engine);
+    
+    // Only bytes that appear in a pattern get their own class, everything else is class 0
+    memset(engine->byte_class, 0, sizeof(engine->byte_class));
+    engine->class_count = 1;
+    
+    int max_states = 1;
+    for (int i = 0; i < engine->trigger_count; i++) {
+        TriggerData *trigger = &engine->triggers[i];
+        for (int j = 0; j < trigger->pattern_length; j++) {
+            unsigned char c = (unsigned char)trigger->pattern[j];
+            if (!engine->case_sensitive) c = (unsigned char)tolower(c);
+            if (!engine->byte_class[c]) {
+                engine->byte_class[c] = (unsigned char)engine->class_count++;
+            }
+        }
+        max_states += trigger->pattern_length;
+    }
+    
+    if (!engine->case_sensitive) {
+        for (int c = 'a'; c <= 'z'; c++) {
+            engine->byte_class[toupper(c)] = engine->byte_class[c];
+        }
+    }
+    
+    int classes = engine->class_count;
+    int shift = 0;
+    while ((1 << shift) < classes) shift++;
+    engine->class_shift = shift;
+    
+    if (((long long)max_states << shift) > INT_MAX / 2) return -1;
+    
+    int *queue = (int *)malloc(sizeof(int) * max_states);
+    
+    engine->delta = (int *)malloc(sizeof(int) * ((size_t)max_states << shift));
+    engine->fail = (int *)calloc(max_states, sizeof(int));
+    engine->depth = (int *)calloc(max_states, sizeof(int));
+    engine->report = (int *)calloc(max_states, sizeof(int));
+    engine->out_first = (int *)malloc(sizeof(int) * max_states);
+    engine->out_next = (int *)malloc(sizeof(int) * (engine->trigger_count + 1));
+    
+    if (!queue || !engine->delta || !engine->fail || !engine->depth || !engine->report || !engine->out_first || !engine->out_next) {
+        free(queue);
+        free_automaton(engine);
+        return -1;
+    }
+    
+    memset(engine->delta, -1, sizeof(int) * ((size_t)max_states << shift));
+    memset(engine->out_first, -1, sizeof(int) * max_states);
+    
+    // Build the trie
+    int state_count = 1;
+    for (int i = 0; i < engine->trigger_count; i++) {
+        TriggerData *trigger = &engine->triggers[i];
+        int state = 0;
+        
+        for (int j = 0; j < trigger->pattern_length; j++) {
+            int c = engine->byte_class[(unsigned char)trigger->pattern[j]];
+            int *next = &engine->delta[(state << shift) + c];
+            if (*next < 0) {
+                engine->depth[state_count] = engine->depth[state] + 1;
+                *next = state_count++;
+            }
+            state = *next;
+        }
+        
+        engine->out_next[i] = engine->out_first[state];
+        engine->out_first[state] = i;
+    }
+    
+    // Breadth-first: fill in fail links and turn the trie into a full transition table
+    int head = 0;
+    int tail = 0;
+    
+    for (int c = 0; c < classes; c++) {
+        int next = engine->delta[c];
+        if (next < 0) {
+            engine->delta[c] = 0;
+        } else {
+            engine->fail[next] = 0;
+            queue[tail++] = next;
+        }
+    }
+    
+    while (head < tail) {
+        int state = queue[head++];
+        int fail = engine->fail[state];
+        
+        engine->report[state] = (engine->out_first[state] >= 0) ? state : engine->report[fail];
+        
+        for (int c = 0; c < classes; c++) {
+            int next = engine->delta[(state << shift) + c];
+            if (next < 0) {
+                engine->delta[(state << shift) + c] = engine->delta[(fail << shift) + c];
+            } else {
+                engine->fail[next] = engine->delta[(fail << shift) + c];
+                queue[tail++] = next;
+            }
+        }
+    }
+    
+    free(queue);
+    
+    // Store row offsets instead of state numbers and flag states with output,
+    // so the scan loop needs no multiply and no second lookup per byte
+    for (int state = 0; state < state_count; state++) {
+        for (int c = 0; c < classes; c++) {
+            int *entry = &engine->delta[(state << shift) + c];
+            *entry = ((*entry << shift) << 1) | (engine->report[*entry] != 0);
+        }
+    }
+    
+    build_filter(engine);
+    
+    engine->state_count = state_count;
+    engine->dirty = 0;
+    
+    return 0;
+}
+
+static void queue_event(TriggerEngineData *engine, TriggerData *trigger, const char *line, int length) {
+    if (engine->pending_count >= engine->pending_capacity) {
+        __atomic_fetch_add(&engine->dropped_count, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    
+    char *event_name = strdup(trigger->event_name);
+    char *line_copy = (char *)malloc(length + 1);
+    if (!event_name || !line_copy) {
+        free(event_name);
+        free(line_copy);
+        __atomic_fetch_add(&engine->dropped_count, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    
+    memcpy(line_copy, line, length);
+    line_copy[length] = '\0';
+    
+    PendingEvent *event = &engine->pending[engine->pending_count++];
+    event->event_name = event_name;
+    event->line = line_copy;
+}
+
+// Record that a trigger fired for an open line, returns 0 if it already had
+static int mark_fired(OpenLine *open_line, int trigger_id) {
+    for (int i = 0; i < open_line->fired_count; i++) {
+        if (open_line->fired[i] == trigger_id) return 0;
+    }
+    
+    if (open_line->fired_count >= open_line->fired_capacity) {
+        int capacity = open_line->fired_capacity ? open_line->fired_capacity * 2 : 4;
+        int *fired = (int *)realloc(open_line->fired, sizeof(int) * capacity);
+        if (!fired) return 1;
+        open_line->fired = fired;
+        open_line->fired_capacity = capacity;
+    }
+    
+    open_line->fired[open_line->fired_count++] = trigger_id;
+    return 1;
+}
+
+static void remove_open_line(TriggerEngineData *engine, int index) {
+    free(engine->open_lines[index].fired);
+    
+    for (int i = index; i < engine->open_line_count - 1; i++) {
+        engine->open_lines[i] = engine->open_lines[i + 1];
+    }
+    engine->open_line_count--;
+}
+
+static OpenLine* find_open_line(TriggerEngineData *engine, int line_id, int create) {
+    for (int i = 0; i < engine->open_line_count; i++) {
+        if (engine->open_lines[i].line_id == line_id) return &engine->open_lines[i];
+    }
+    if (!create) return NULL;
+    
+    // Lines whose last version was dropped are never closed, forget the oldest
+    if (engine->open_line_count >= MAX_OPEN_LINES) {
+        remove_open_line(engine, 0);
+    }
+    
+    if (engine->open_line_count >= engine->open_line_capacity) {
+        int capacity = engine->open_line_capacity ? engine->open_line_capacity * 2 : 4;
+        OpenLine *open_lines = (OpenLine *)realloc(engine->open_lines, sizeof(OpenLine) * capacity);
+        if (!open_lines) return NULL;
+        engine->open_lines = open_lines;
+        engine->open_line_capacity = capacity;
+    }
+    
+    OpenLine *open_line = &engine->open_lines[engine->open_line_count++];
+    memset(open_line, 0, sizeof(OpenLine));
+    open_line->line_id = line_id;
+    return open_line;
+}
+
+// Queue every trigger whose pattern ends in this state, at most once per line
+static void report_matches(TriggerEngineData *engine, int state, const char *line, int length, long long serial) {
+    for (int match = engine->report[state]; match > 0; match = engine->report[engine->fail[match]]) {
+        for (int k = engine->out_first[match]; k >= 0; k = engine->out_next[k]) {
+            TriggerData *trigger = &engine->triggers[k];
+            if (trigger->last_hit_line == serial) continue;
+            
+            trigger->last_hit_line = serial;
+            if (engine->current_line && !mark_fired(engine->current_line, trigger->id)) continue;
+            
+            engine->match_count++;
+            queue_event(engine, trigger, line, length);
+        }
+    }
+}
+
+// Run the automaton over line[from, length). With anchored set, stop as soon
+// as no pattern starting at from can still match. Returns the bytes scanned.
+static int run_automaton(TriggerEngineData *engine, const char *line, int length, int from, int anchored,
+                         long long serial) {
+    const int *delta = engine->delta;
+    const int *depth = engine->depth;
+    const unsigned char *byte_class = engine->byte_class;
+    int shift = engine->class_shift + 1;
+    int entry = 0;
+    int i;
+    
+    for (i = from; i < length; i++) {
+        entry = delta[(entry >> 1) + byte_class[(unsigned char)line[i]]];
+        
+        if (anchored && depth[entry >> shift] != i - from + 1) break;
+        if (entry & 1) {
+            report_matches(engine, entry >> shift, line, length, serial);
+        }
+    }
+    
+    return i - from;
+}
+
+static void match_line(TriggerEngineData *engine, const char *line, int length, long long serial) {
+    if (!engine->skip_window) {
+        run_automaton(engine, line, length, 0, 0, serial);
+        return;
+    }
+    
+    const unsigned char *bytes = (const unsigned char *)line;
+    const unsigned char *fold = engine->fold;
+    const unsigned char *skip = engine->skip;
+    int window = engine->skip_window;
+    int verified = 0;
+    
+    for (int pos = window - 1; pos < length; ) {
+        int shift = skip[skip_key(fold, bytes + pos - 2)];
+        if (shift > 0) {
+            pos += shift;
+            continue;
+        }
+        
+        // Some pattern prefix may end at pos, check for a match starting at its window
+        int from = pos - window + 1;
+        
+        // Too many candidates, finish with one pass so the cost stays linear
+        if (verified > length) {
+            run_automaton(engine, line, length, from, 0, serial);
+            break;
+        }
+        
+        verified += run_automaton(engine, line, length, from, 1, serial) + 1;
+        pos++;
+    }
+}
+
+// Take the next line off the queue and match it, returns 0 if the queue is empty
+static int match_next_line(TriggerEngineData *engine) {
+    size_t tail = engine->queue_tail;
+    size_t head = __atomic_load_n(&engine->queue_head, __ATOMIC_ACQUIRE);
+    if (tail == head) return 0;
+    
+    size_t offset = tail & (LINE_QUEUE_SIZE - 1);
+    LineRecord header;
+    memcpy(&header, engine->queue + offset, sizeof(header));
+    offset += sizeof(header);
+    
+    uint32_t length = header.length & ~LINE_RECORD_OPEN;
+    int is_open = (header.length & LINE_RECORD_OPEN) != 0;
+    const char *line = engine->queue + offset;
+    int matchable = engine->state_count > 0;
+    
+    if (matchable && offset + length > LINE_QUEUE_SIZE) {
+        if ((int)length > engine->wrapped_capacity) {
+            char *wrapped = (char *)realloc(engine->wrapped_line, length);
+            if (wrapped) {
+                engine->wrapped_line = wrapped;
+                engine->wrapped_capacity = (int)length;
+            }
+        }
+        
+        if ((int)length <= engine->wrapped_capacity) {
+            size_t first = LINE_QUEUE_SIZE - offset;
+            memcpy(engine->wrapped_line, line, first);
+            memcpy(engine->wrapped_line + first, engine->queue, length - first);
+            line = engine->wrapped_line;
+        } else {
+            matchable = 0;
+        }
+    }
+    
+    // Versions of an unfinished line share the triggers that fired for it
+    OpenLine *open_line = engine->open_line_count || is_open
+        ? find_open_line(engine, (int)header.line_id, is_open) : NULL;
+    
+    if (matchable) {
+        engine->current_line = open_line;
+        match_line(engine, line, (int)length, ++engine->record_serial);
+        engine->current_line = NULL;
+    }
+    
+    if (open_line && !is_open) {
+        remove_open_line(engine, (int)(open_line - engine->open_lines));
+    }
+    
+    // Only now may the parse thread reuse the space
+    size_t record = (sizeof(header) + length + 7) & ~(size_t)7;
+    __atomic_store_n(&engine->queue_tail, tail + record, __ATOMIC_RELEASE);
+    
+    return 1;
+}
+
+// Rebuild the automaton and make room for one more line's worth of events per trigger
+static void rebuild(TriggerEngineData *engine) {
+    if (engine->trigger_count == 0) {
+        free_automaton(engine);
+        engine->dirty = 0;
+        return;
+    }
+    
+    if (build_automaton(engine) < 0) return;
+    
+    int capacity = MAX_PENDING_EVENTS + engine->trigger_count;
+    if (capacity > engine->pending_capacity) {
+        PendingEvent *pending = (PendingEvent *)realloc(engine->pending, sizeof(PendingEvent) * capacity);
+        if (pending) {
+            engine->pending = pending;
+            engine->pending_capacity = capacity;
+        }
+    }
+}
+
+static void* trigger_thread(void* arg) {
+    TriggerEngineData *engine = (TriggerEngineData *)arg;
+    
+    pthread_mutex_lock(&engine->mutex);
+    
+    while (1) {
+        // Announce the wait before the final check, so the parse thread
+        // either sees it or its line is seen here
+        int waited = 0;
+        while (engine->queue_tail == __atomic_load_n(&engine->queue_head, __ATOMIC_SEQ_CST) && !engine->stopping) {
+            __atomic_store_n(&engine->waiting, WAIT_FOR_LINES, __ATOMIC_SEQ_CST);
+            if (engine->queue_tail == __atomic_load_n(&engine->queue_head, __ATOMIC_SEQ_CST)) {
+                pthread_cond_wait(&engine->has_lines, &engine->mutex);
+            }
+            __atomic_store_n(&engine->waiting, WAIT_NONE, __ATOMIC_SEQ_CST);
+            waited = 1;
+        }
+        
+        // Output arrives in bursts; let a batch build up instead of waking
+        // up for every line, unless someone is waiting for it
+        if (waited && !engine->stopping && engine->flush_requests == 0) {
+            struct timeval now;
+            gettimeofday(&now, NULL);
+            
+            long long usec = (long long)now.tv_usec + BATCH_DELAY_MS * 1000;
+            struct timespec deadline;
+            deadline.tv_sec = now.tv_sec + (time_t)(usec / 1000000);
+            deadline.tv_nsec = (long)(usec % 1000000) * 1000;
+            
+            __atomic_store_n(&engine->waiting, WAIT_FOR_BATCH, __ATOMIC_SEQ_CST);
+            pthread_cond_timedwait(&engine->has_lines, &engine->mutex, &deadline);
+            __atomic_store_n(&engine->waiting, WAIT_NONE, __ATOMIC_SEQ_CST);
+        }
+        
+        if (engine->queue_tail == __atomic_load_n(&engine->queue_head, __ATOMIC_SEQ_CST)) break;
+        
+        if (engine->dirty) {
+            rebuild(engine);
+        }
+        
+        // Match until the queue is empty or there is a batch of events to hand over
+        while (engine->pending_count < MAX_PENDING_EVENTS && match_next_line(engine)) {
+        }
+        
+        int batch_count = engine->pending_count;
+        engine->pending_count = 0;
+        engine->is_delivering = 1;
+        
+        // Scripts may add or remove triggers, so deliver without the mutex
+        pthread_mutex_unlock(&engine->mutex);
+        
+        for (int i = 0; i < batch_count; i++) {
+            if (engine->scripting) {
+                scripting_engine_trigger_event(engine->scripting, engine->pending[i].event_name, engine->pending[i].line);
+            }
+            free(engine->pending[i].event_name);
+            free(engine->pending[i].line);
+        }
+        
+        pthread_mutex_lock(&engine->mutex);
+        engine->is_delivering = 0;
+        pthread_cond_broadcast(&engine->idle);
+    }
+    
+    pthread_mutex_unlock(&engine->mutex);
+    
+    return NULL;
+}
+
+TriggerEngine* trigger_engine_create(ScriptingEngine* scripting) {
+    TriggerEngineData *engine = (TriggerEngineData *)malloc(sizeof(TriggerEngineData));
+    if (!engine) return NULL;
+    
+    memset(engine, 0, sizeof(TriggerEngineData));
+    
+    engine->scripting = scripting;
+    engine->case_sensitive = 1;
+    engine->next_id = 1;
+    engine->next_line_id = 1;
+    engine->dirty = 1;
+    
+    engine->triggers = (TriggerData *)malloc(sizeof(TriggerData) * INITIAL_TRIGGER_CAPACITY);
+    engine->pending = (PendingEvent *)malloc(sizeof(PendingEvent) * MAX_PENDING_EVENTS);
+    engine->queue = (char *)malloc(LINE_QUEUE_SIZE);
+    
+    if (!engine->triggers || !engine->pending || !engine->queue) {
+        free(engine->triggers);
+        free(engine->pending);
+        free(engine->queue);
+        free(engine);
+        return NULL;
+    }
+    
+    engine->trigger_capacity = INITIAL_TRIGGER_CAPACITY;
+    engine->pending_capacity = MAX_PENDING_EVENTS;
+    
+    pthread_mutex_init(&engine->mutex, NULL);
+    pthread_cond_init(&engine->has_lines, NULL);
+    pthread_cond_init(&engine->idle, NULL);
+    
+    if (pthread_create(&engine->thread, NULL, trigger_thread, engine) != 0) {
+        pthread_cond_destroy(&engine->idle);
+        pthread_cond_destroy(&engine->has_lines);
+        pthread_mutex_destroy(&engine->mutex);
+        free(engine->triggers);
+        free(engine->pending);
+        free(engine->queue);
+        free(engine);
+        return NULL;
+    }
+    
+    return (TriggerEngine *)engine;
+}
+
+void trigger_engine_destroy(TriggerEngine* engine) {
+    if (!engine) return;
+    
+    TriggerEngineData *engine_data = (TriggerEngineData *)engine;
+    
+    // Match and deliver whatever is still queued, then stop the trigger thread
+    pthread_mutex_lock(&engine_data->mutex);
+    engine_data->stopping = 1;
+    pthread_cond_signal(&engine_data->has_lines);
+    pthread_mutex_unlock(&engine_data->mutex);
+    
+    pthread_join(engine_data->thread, NULL);
+    
+    pthread_cond_destroy(&engine_data->idle);
+    pthread_cond_destroy(&engine_data->has_lines);
+    pthread_mutex_destroy(&engine_data->mutex);
+    
+    for (int i = 0; i < engine_data->trigger_count; i++) {
+        free(engine_data->triggers[i].pattern);
+        free(engine_data->triggers[i].event_name);
+    }
+    free_automaton(engine_data);
+    
+    free(engine_data->triggers);
+    free(engine_data->pending);
+    free(engine_data->queue);
+    free(engine_data->wrapped_line);
+    
+    for (int i = 0; i < engine_data->open_line_count; i++) {
+        free(engine_data->open_lines[i].fired);
+    }
+    free(engine_data->open_lines);
+    free(engine_data);
+}
+
+int trigger_engine_add_trigger(TriggerEngine* engine, const char* pattern, const char* event_name) {
+    if (!engine || !pattern || !*pattern || !event_name) return -1;
+    
+    TriggerEngineData *engine_data = (TriggerEngineData *)engine;
+    
+    pthread_mutex_lock(&engine_data->mutex);
+    
+    if (engine_data->trigger_count >= engine_data->trigger_capacity) {
+        int capacity = engine_data->trigger_capacity * 2;
+        TriggerData *triggers = (TriggerData *)realloc(engine_data->triggers, sizeof(TriggerData) * capacity);
+        if (!triggers) {
+            pthread_mutex_unlock(&engine_data->mutex);
+            return -1;
+        }
+        engine_data->triggers = triggers;
+        engine_data->trigger_capacity = capacity;
+    }
+    
+    TriggerData *trigger = &engine_data->triggers[engine_data->trigger_count];
+    memset(trigger, 0, sizeof(TriggerData));
+    
+    trigger->pattern = strdup(pattern);
+    trigger->event_name = strdup(event_name);
+    if (!trigger->pattern || !trigger->event_name) {
+        free(trigger->pattern);
+        free(trigger->event_name);
+        pthread_mutex_unlock(&engine_data->mutex);
+        return -1;
+    }
+    
+    trigger->id = engine_data->next_id++;
+    trigger->pattern_length = (int)strlen(pattern);
+    trigger->last_hit_line = -1;
+    
+    __atomic_store_n(&engine_data->trigger_count, engine_data->trigger_count + 1, __ATOMIC_RELAXED);
+    engine_data->dirty = 1;
+    
+    int id = trigger->id;
+    pthread_mutex_unlock(&engine_data->mutex);
+    
+    return id;
+}
+
+int trigger_engine_remove_trigger(TriggerEngine* engine, int trigger_id) {
+    if (!engine) return -1;
+    
+    TriggerEngineData *engine_data = (TriggerEngineData *)engine;
+    
+    pthread_mutex_lock(&engine_data->mutex);
+    
+    for (int i = 0; i < engine_data->trigger_count; i++) {
+        if (engine_data->triggers[i].id != trigger_id) continue;
+        
+        free(engine_data->triggers[i].pattern);
+        free(engine_data->triggers[i].event_name);
+        
+        // Shift remaining triggers
+        for (int j = i; j < engine_data->trigger_count - 1; j++) {
+            engine_data->triggers[j] = engine_data->triggers[j + 1];
+        }
+        
+        __atomic_store_n(&engine_data->trigger_count, engine_data->trigger_count - 1, __ATOMIC_RELAXED);
+        engine_data->dirty = 1;
+        
+        pthread_mutex_unlock(&engine_data->mutex);
+        return 0;
+    }
+    
+    pthread_mutex_unlock(&engine_data->mutex);
+    return -1;
+}
+
+int trigger_engine_get_trigger_count(TriggerEngine* engine) {
+    if (!engine) return 0;
+    return __atomic_load_n(&((TriggerEngineData *)engine)->trigger_count, __ATOMIC_RELAXED);
+}
+
+void trigger_engine_clear(TriggerEngine* engine) {
+    if (!engine) return;
+    
+    TriggerEngineData *engine_data = (TriggerEngineData *)engine;
+    
+    pthread_mutex_lock(&engine_data->mutex);
+    
+    for (int i = 0; i < engine_data->trigger_count; i++) {
+        free(engine_data->triggers[i].pattern);
+        free(engine_data->triggers[i].event_name);
+    }
+    
+    __atomic_store_n(&engine_data->trigger_count, 0, __ATOMIC_RELAXED);
+    engine_data->dirty = 1;
+    
+    pthread_mutex_unlock(&engine_data->mutex);
+}
+
+void trigger_engine_set_case_sensitive(TriggerEngine* engine, int case_sensitive) {
+    if (!engine) return;
+    
+    TriggerEngineData *engine_data = (TriggerEngineData *)engine;
+    
+    pthread_mutex_lock(&engine_data->mutex);
+    if (engine_data->case_sensitive != case_sensitive) {
+        engine_data->case_sensitive = case_sensitive;
+        engine_data->dirty = 1;
+    }
+    pthread_mutex_unlock(&engine_data->mutex);
+}
+
+int trigger_engine_get_case_sensitive(TriggerEngine* engine) {
+    if (!engine) return 0;
+    return ((TriggerEngineData *)engine)->case_sensitive;
+}
+
+static int queue_record(TriggerEngineData *engine_data, int line_id, const char *line, int length, int finished) {
+    if (!line || length < 0) return 0;
+    
+    if (__atomic_load_n(&engine_data->trigger_count, __ATOMIC_RELAXED) == 0) return 0;
+    
+    LineRecord header = { (uint32_t)length | (finished ? 0 : LINE_RECORD_OPEN), (uint32_t)line_id };
+    size_t record = (sizeof(header) + length + 7) & ~(size_t)7;
+    size_t head = engine_data->queue_staged;
+    size_t tail = __atomic_load_n(&engine_data->queue_tail, __ATOMIC_ACQUIRE);
+    
+    // Never block the parse thread behind a slow script; drop instead
+    if (record > LINE_QUEUE_SIZE - (head - tail)) {
+        __atomic_fetch_add(&engine_data->dropped_count, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    
+    size_t offset = head & (LINE_QUEUE_SIZE - 1);
+    memcpy(engine_data->queue + offset, &header, sizeof(header));
+    offset += sizeof(header);
+    
+    size_t first = LINE_QUEUE_SIZE - offset;
+    if ((size_t)length <= first) {
+        memcpy(engine_data->queue + offset, line, length);
+    } else {
+        memcpy(engine_data->queue + offset, line, first);
+        memcpy(engine_data->queue, line + first, length - first);
+    }
+    
+    engine_data->queue_staged = head + record;
+    
+    return line_id;
+}
+
+// Ids only need to differ from recent ones, 0 means dropped
+static int new_line_id(TriggerEngineData *engine_data) {
+    int line_id = engine_data->next_line_id;
+    engine_data->next_line_id = (line_id == INT_MAX) ? 1 : line_id + 1;
+    return line_id;
+}
+
+int trigger_engine_queue_line(TriggerEngine* engine, const char* line, int length) {
+    if (!engine || length <= 0) return 0;
+    
+    TriggerEngineData *engine_data = (TriggerEngineData *)engine;
+    return queue_record(engine_data, new_line_id(engine_data), line, length, 1);
+}
+
+int trigger_engine_update_line(TriggerEngine* engine, int line_id, const char* line, int length, int finished) {
+    if (!engine || line_id < 0) return 0;
+    
+    TriggerEngineData *engine_data = (TriggerEngineData *)engine;
+    
+    if (line_id == 0) {
+        if (length <= 0) return 0;
+        line_id = new_line_id(engine_data);
+    }
+    
+    return queue_record(engine_data, line_id, line, length, finished);
+}
+
+void trigger_engine_publish(TriggerEngine* engine) {
+    if (!engine) return;
+    
+    TriggerEngineData *engine_data = (TriggerEngineData *)engine;
+    size_t head = engine_data->queue_staged;
+    if (head == engine_data->queue_head) return;
+    
+    __atomic_store_n(&engine_data->queue_head, head, __ATOMIC_SEQ_CST);
+    
+    size_t tail = __atomic_load_n(&engine_data->queue_tail, __ATOMIC_ACQUIRE);
+    int waiting = __atomic_load_n(&engine_data->waiting, __ATOMIC_SEQ_CST);
+    if (waiting == WAIT_FOR_LINES ||
+        (waiting == WAIT_FOR_BATCH && head - tail > LINE_QUEUE_SIZE / 2)) {
+        pthread_mutex_lock(&engine_data->mutex);
+        pthread_cond_signal(&engine_data->has_lines);
+        pthread_mutex_unlock(&engine_data->mutex);
+    }
+}
+
+void trigger_engine_flush(TriggerEngine* engine) {
+    if (!engine) return;
+    
+    TriggerEngineData *engine_data = (TriggerEngineData *)engine;
+    
+    pthread_mutex_lock(&engine_data->mutex);
+    engine_data->flush_requests++;
+    pthread_cond_signal(&engine_data->has_lines);
+    
+    while (engine_data->queue_tail != __atomic_load_n(&engine_data->queue_head, __ATOMIC_SEQ_CST) ||
+           engine_data->is_delivering) {
+        pthread_cond_wait(&engine_data->idle, &engine_data->mutex);
+    }
+    
+    engine_data->flush_requests--;
+    pthread_mutex_unlock(&engine_data->mutex);
+}
+
+long long trigger_engine_get_match_count(TriggerEngine* engine) {
+    if (!engine) return 0;
+    
+    TriggerEngineData *engine_data = (TriggerEngineData *)engine;
+    
+    pthread_mutex_lock(&engine_data->mutex);
+    long long matches = engine_data->match_count;
+    pthread_mutex_unlock(&engine_data->mutex);
+    
+    return matches;
+}
+
+long long trigger_engine_get_dropped_count(TriggerEngine* engine) {
+    if (!engine) return 0;
+    return __atomic_load_n(&((TriggerEngineData *)engine)->dropped_count, __ATOMIC_RELAXED);
+}
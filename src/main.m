@@ -16,9 +16,11 @@
 #import "inc/shell.h"
 #import "inc/input.h"
 #import "inc/terminal.h"
+#import "inc/event_loop.h"
 
 #define WINDOW_WIDTH 1200
 #define WINDOW_HEIGHT 800
+#define DRAIN_BUDGET_MS 8    // Half of a 60 Hz frame for parsing shell output
 
 // Global variables for the application state
 static Window *g_window = NULL;
@@ -26,6 +28,7 @@ static Renderer *g_renderer = NULL;
 static Shell *g_shell = NULL;
 static InputHandler *g_input = NULL;
 static Terminal *g_terminal = NULL;
+static EventLoop *g_event_loop = NULL;
 
 // Input callback for keyboard events
 void on_key_input(void* context, int key, int action) {
@@ -134,24 +137,14 @@ void on_key_input(void* context, int key, int action) {
 }
 
 - (void)update:(NSTimer *)timer {
-    char buffer[4096];
-    int bytes_read;
-    
     @autoreleasepool {
-        // Read shell output
-        if (g_shell && shell_is_running(g_shell)) {
-            bytes_read = shell_read_output(g_shell, buffer, sizeof(buffer) - 1);
-            if (bytes_read > 0) {
-                buffer[bytes_read] = '\0';
-                // Write to terminal buffer instead of stdout
-                if (g_terminal) {
-                    terminal_write(g_terminal, buffer, bytes_read);
-                }
-            }
+        // Dispatch output from every registered shell to its terminal
+        if (g_event_loop) {
+            event_loop_drain(g_event_loop, DRAIN_BUDGET_MS);
         }
         
-        // Trigger window redraw on every update cycle
-        if (g_window) {
+        // Only redraw when a visible terminal received output
+        if (g_window && event_loop_needs_redraw(g_event_loop)) {
             window_refresh(g_window);
         }
     }
@@ -260,10 +253,23 @@ int main() {
         // Set initial PTY window size to match terminal
         shell_resize_pty(g_shell, term_cols, term_rows);
         
+        // Create event loop and register the shell's PTY with it
+        g_event_loop = event_loop_create(0);
+        if (!g_event_loop || event_loop_add_source(g_event_loop, g_shell, g_terminal) < 0) {
+            fprintf(stderr, "Failed to create event loop\n");
+            event_loop_destroy(g_event_loop);
+            shell_destroy(g_shell);
+            renderer_destroy(g_renderer);
+            window_destroy(g_window);
+            return 1;
+        }
+        event_loop_set_visibility(g_event_loop, g_shell, EVENT_SOURCE_VISIBLE);
+        
         // Create input handler
         g_input = input_create();
         if (!g_input) {
             fprintf(stderr, "Failed to create input handler\n");
+            event_loop_destroy(g_event_loop);
             shell_destroy(g_shell);
             renderer_destroy(g_renderer);
             window_destroy(g_window);
@@ -302,6 +308,9 @@ int main() {
         if (g_input) {
             input_destroy(g_input);
         }
+        if (g_event_loop) {
+            event_loop_destroy(g_event_loop);
+        }
         if (g_shell) {
             shell_destroy(g_shell);
         }
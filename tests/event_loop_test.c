@@ -0,0 +1,200 @@
+// Event loop test: real shells on real PTYs, no window.
+//
+// Starts more shells than the default source capacity, checks each one's
+// output reaches its own terminal, that syncing after closing a tab drops
+// its source, and that one drain reads past the per-poll read budget.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "event_loop.h"
+#include "shell.h"
+#include "terminal.h"
+#include "tabs.h"
+#include "scripting.h"
+
+#define SHELL_COUNT 80           // More than the event loop's initial 64 slots
+#define TERMINAL_WIDTH 80
+#define TERMINAL_HEIGHT 24
+#define TIMEOUT_MS 20000
+#define LARGE_OUTPUT_BYTES 1000000
+
+// triggers.m calls into the scripting engine, which needs Foundation
+int scripting_engine_trigger_event(ScriptingEngine* engine, const char* event_name, const char* data) {
+    (void)engine;
+    (void)event_name;
+    (void)data;
+    return 0;
+}
+
+static int failures = 0;
+
+#define CHECK(condition, message) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, message); \
+        failures++; \
+    } \
+} while (0)
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int screen_contains(Terminal *terminal, const char *text) {
+    const char *screen = terminal_get_text(terminal);
+    int size = terminal_get_width(terminal) * terminal_get_height(terminal);
+    int length = (int)strlen(text);
+    
+    for (int i = 0; i + length <= size; i++) {
+        if (memcmp(screen + i, text, length) == 0) return 1;
+    }
+    return 0;
+}
+
+static void send(Shell *shell, const char *command) {
+    shell_write_input(shell, command, (int)strlen(command));
+}
+
+// The marker is built by the shell so the echoed command never matches it
+static void send_marker(Shell *shell, int id) {
+    char command[64];
+    snprintf(command, sizeof(command), "echo mark$((%d+0))end\n", id);
+    send(shell, command);
+}
+
+static int marker_seen(Terminal *terminal, int id) {
+    char marker[32];
+    snprintf(marker, sizeof(marker), "mark%dend", id);
+    return screen_contains(terminal, marker);
+}
+
+static void test_many_shells(void) {
+    EventLoop *loop = event_loop_create(0);
+    TabManager *manager = tab_manager_create(SHELL_COUNT);
+    Shell *shells[SHELL_COUNT];
+    Terminal *terminals[SHELL_COUNT];
+    
+    for (int i = 0; i < SHELL_COUNT; i++) {
+        shells[i] = shell_create();
+        terminals[i] = terminal_create(TERMINAL_WIDTH, TERMINAL_HEIGHT);
+        CHECK(shell_init_pty(shells[i]) == 0, "shell_init_pty failed");
+        
+        Tab *tab = tab_manager_add_tab(manager, "sh");
+        tab_set_shell(tab, shells[i]);
+        tab_set_terminal(tab, terminals[i]);
+    }
+    
+    event_loop_sync_tabs(loop, manager);
+    CHECK(event_loop_get_source_count(loop) == SHELL_COUNT, "not every shell was registered");
+    
+    for (int i = 0; i < SHELL_COUNT; i++) {
+        send_marker(shells[i], i);
+    }
+    
+    int seen = 0;
+    double deadline = now_ms() + TIMEOUT_MS;
+    while (seen < SHELL_COUNT && now_ms() < deadline) {
+        event_loop_poll(loop, 50);
+        
+        seen = 0;
+        for (int i = 0; i < SHELL_COUNT; i++) {
+            seen += marker_seen(terminals[i], i);
+        }
+    }
+    CHECK(seen == SHELL_COUNT, "output of some shells never arrived");
+    
+    // Each terminal only holds its own shell's output
+    CHECK(!marker_seen(terminals[0], 1), "output reached the wrong terminal");
+    CHECK(!marker_seen(terminals[SHELL_COUNT - 1], 0), "output reached the wrong terminal");
+    
+    // Close tab 1: sync drops its source before the shell is destroyed
+    Shell *closed_shell = shells[1];
+    Terminal *closed_terminal = terminals[1];
+    tab_manager_remove_tab(manager, 1);
+    event_loop_sync_tabs(loop, manager);
+    CHECK(event_loop_get_source_count(loop) == SHELL_COUNT - 1, "sync kept the closed tab's source");
+    
+    send(closed_shell, "exit\n");
+    shell_destroy(closed_shell);
+    terminal_destroy(closed_terminal);
+    
+    // The remaining shells are still served after the removal
+    send_marker(shells[SHELL_COUNT - 1], SHELL_COUNT);
+    deadline = now_ms() + TIMEOUT_MS;
+    while (!marker_seen(terminals[SHELL_COUNT - 1], SHELL_COUNT) && now_ms() < deadline) {
+        event_loop_poll(loop, 50);
+    }
+    CHECK(marker_seen(terminals[SHELL_COUNT - 1], SHELL_COUNT), "shell not served after a removal");
+    
+    for (int i = 0; i < SHELL_COUNT; i++) {
+        if (i == 1) continue;
+        CHECK(event_loop_remove_source(loop, shells[i]) == 0, "event_loop_remove_source failed");
+        send(shells[i], "exit\n");
+        shell_destroy(shells[i]);
+        terminal_destroy(terminals[i]);
+    }
+    CHECK(event_loop_get_source_count(loop) == 0, "sources left after removing all");
+    
+    tab_manager_destroy(manager);
+    event_loop_destroy(loop);
+}
+
+static void test_drain_past_read_budget(void) {
+    EventLoop *loop = event_loop_create(0);
+    Shell *shell = shell_create();
+    Terminal *terminal = terminal_create(TERMINAL_WIDTH, TERMINAL_HEIGHT);
+    
+    CHECK(shell_init_pty(shell) == 0, "shell_init_pty failed");
+    CHECK(event_loop_add_source(loop, shell, terminal) == 0, "event_loop_add_source failed");
+    CHECK(event_loop_add_source(loop, shell, terminal) == 0, "re-adding a source failed");
+    CHECK(event_loop_get_source_count(loop) == 1, "a source was registered twice");
+    
+    char command[128];
+    snprintf(command, sizeof(command),
+             "yes 0123456789abcdef0123456789abcdef | head -c %d; echo mark$((0+0))end\n",
+             LARGE_OUTPUT_BYTES);
+    send(shell, command);
+    
+    // Wait for the first output, then see how much one drain takes in
+    double deadline = now_ms() + TIMEOUT_MS;
+    int largest = 0;
+    long total = 0;
+    while (!marker_seen(terminal, 0) && now_ms() < deadline) {
+        event_loop_poll(loop, 50);
+        usleep(10000);
+        
+        int bytes = event_loop_drain(loop, 100);
+        if (bytes > largest) largest = bytes;
+        total += bytes;
+    }
+    CHECK(marker_seen(terminal, 0), "large output never finished");
+    CHECK(largest > 65536, "a drain stopped at the per-poll read budget");
+    
+    event_loop_remove_source(loop, shell);
+    send(shell, "exit\n");
+    shell_destroy(shell);
+    terminal_destroy(terminal);
+    event_loop_destroy(loop);
+    
+    printf("largest drain %d bytes (%ld total)\n", largest, total);
+}
+
+int main(void) {
+    // A plain shell starts fast and ignores the user's rc files
+    setenv("SHELL", "/bin/sh", 1);
+    
+    test_many_shells();
+    test_drain_past_read_budget();
+    
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    
+    printf("event loop: all checks passed\n");
+    return 0;
+}
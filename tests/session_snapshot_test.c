@@ -0,0 +1,402 @@
+// Session snapshot test: what a snapshot restores against the live tabs.
+//
+// Saves a few tabs over and over while their scrollback fills, overflows and
+// the file gets compacted, and checks after every save that the snapshot
+// holds each tab's live scrollback, screen and title under the same tab id.
+// Then restores the tabs from the file as the app does at startup, keeps
+// saving into the same file, and cuts saves short to check that a torn tail
+// is ignored by the reader and dropped by the writer.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "session_snapshot.h"
+#include "terminal.h"
+#include "scrollback.h"
+#include "tabs.h"
+#include "scripting.h"
+
+#define SNAPSHOT_PATH "/tmp/mterm_snapshot_test.mtsnap"
+#define TAB_COUNT 3
+#define MAX_TABS 8
+#define SCROLLBACK_LINES 2000
+#define LINES_PER_SAVE 1500
+#define SAVES 40
+#define TERMINAL_WIDTH 80
+#define TERMINAL_HEIGHT 24
+
+// triggers.m calls into the scripting engine, which needs Foundation
+int scripting_engine_trigger_event(ScriptingEngine* engine, const char* event_name, const char* data) {
+    (void)engine;
+    (void)event_name;
+    (void)data;
+    return 0;
+}
+
+static int failures = 0;
+
+#define CHECK(condition, message) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, message); \
+        failures++; \
+    } \
+} while (0)
+
+typedef struct {
+    TabManager *manager;
+    Terminal *terminals[MAX_TABS];
+    Scrollback *scrollbacks[MAX_TABS];
+    int count;
+    long long next_line;
+} Session;
+
+// What one tab looks like, from the live tab or from the snapshot
+typedef struct {
+    int id;
+    int line_count;
+    uint64_t line_hash;
+    uint64_t screen_hash;
+    uint64_t title_hash;
+} TabState;
+
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t length) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t hash_string(uint64_t hash, const char *text) {
+    return hash_bytes(hash, text ? text : "", strlen(text ? text : "") + 1);
+}
+
+static uint64_t hash_screen(Terminal *terminal) {
+    uint64_t hash = hash_bytes(14695981039346656037ULL, terminal_get_text(terminal),
+                               (size_t)terminal_get_width(terminal) * terminal_get_height(terminal));
+    int cursor[2] = { terminal_get_cursor_x(terminal), terminal_get_cursor_y(terminal) };
+    return hash_bytes(hash, cursor, sizeof(cursor));
+}
+
+static long file_size(void) {
+    struct stat st;
+    return stat(SNAPSHOT_PATH, &st) == 0 ? (long)st.st_size : -1;
+}
+
+static Session* session_create(void) {
+    Session *session = (Session *)calloc(1, sizeof(Session));
+    session->manager = tab_manager_create(MAX_TABS);
+    return session;
+}
+
+static int session_add_tab(Session *session, const char *title) {
+    int index = session->count++;
+    Tab *tab = tab_manager_add_tab(session->manager, title);
+    
+    session->terminals[index] = terminal_create(TERMINAL_WIDTH, TERMINAL_HEIGHT);
+    session->scrollbacks[index] = scrollback_create(SCROLLBACK_LINES);
+    terminal_set_scrollback(session->terminals[index], session->scrollbacks[index]);
+    tab_set_terminal(tab, session->terminals[index]);
+    return index;
+}
+
+static void session_destroy(Session *session) {
+    for (int i = 0; i < session->count; i++) {
+        terminal_destroy(session->terminals[i]);
+        scrollback_destroy(session->scrollbacks[i]);
+    }
+    tab_manager_destroy(session->manager);
+    free(session);
+}
+
+// Lines of varying length (some empty) through the terminal, scrolling the
+// screen into the scrollback
+static void write_lines(Session *session, int index, int count) {
+    static const char filler[] = "..................................................";
+    char line[TERMINAL_WIDTH + 8];
+    
+    for (int i = 0; i < count; i++) {
+        long long n = session->next_line++;
+        int length = (n % 11 == 0) ? snprintf(line, sizeof(line), "\r\n")
+                                   : snprintf(line, sizeof(line), "tab %d line %lld %.*s\r\n",
+                                              index, n, (int)(n * 7 % 50), filler);
+        terminal_write(session->terminals[index], line, length);
+    }
+}
+
+static void live_state(Session *session, int index, int id, TabState *state) {
+    Scrollback *scrollback = session->scrollbacks[index];
+    
+    state->id = id;
+    state->line_count = scrollback_get_line_count(scrollback);
+    state->line_hash = 14695981039346656037ULL;
+    for (int i = 0; i < state->line_count; i++) {
+        state->line_hash = hash_string(state->line_hash, scrollback_get_line(scrollback, i));
+    }
+    state->screen_hash = hash_screen(session->terminals[index]);
+    state->title_hash = hash_string(14695981039346656037ULL,
+                                    tab_get_title(tab_manager_get_tab(session->manager, index)));
+}
+
+static void snapshot_state(SessionSnapshot *snapshot, int index, TabState *state) {
+    Terminal *terminal = terminal_create(TERMINAL_WIDTH, TERMINAL_HEIGHT);
+    
+    state->id = session_snapshot_get_tab_id(snapshot, index);
+    state->line_count = session_snapshot_get_line_count(snapshot, index);
+    state->line_hash = 14695981039346656037ULL;
+    for (int i = 0; i < state->line_count; i++) {
+        state->line_hash = hash_string(state->line_hash, session_snapshot_get_line(snapshot, index, i));
+    }
+    state->screen_hash = (session_snapshot_restore_screen(snapshot, index, terminal) == 0) ? hash_screen(terminal) : 0;
+    state->title_hash = hash_string(14695981039346656037ULL, session_snapshot_get_tab_title(snapshot, index));
+    
+    terminal_destroy(terminal);
+}
+
+static SessionSnapshot* open_snapshot(void) {
+    SessionSnapshot *snapshot = session_snapshot_open(SNAPSHOT_PATH);
+    CHECK(snapshot != NULL, "session_snapshot_open failed");
+    if (snapshot) session_snapshot_set_max_lines(snapshot, SCROLLBACK_LINES);
+    return snapshot;
+}
+
+// The snapshot's state of every tab
+static int read_states(TabState *states) {
+    SessionSnapshot *snapshot = open_snapshot();
+    if (!snapshot) return 0;
+    
+    int count = session_snapshot_get_tab_count(snapshot);
+    for (int i = 0; i < count && i < MAX_TABS; i++) {
+        snapshot_state(snapshot, i, &states[i]);
+    }
+    
+    session_snapshot_close(snapshot);
+    return count;
+}
+
+// The snapshot holds every live tab as it is now, under the expected ids
+static int check_snapshot(Session *session, const int *ids, const char *what) {
+    TabState saved[MAX_TABS];
+    int count = read_states(saved);
+    int failed = (count != session->count);
+    
+    for (int i = 0; i < count && !failed; i++) {
+        TabState live;
+        live_state(session, i, ids[i], &live);
+        failed = memcmp(&live, &saved[i], sizeof(live)) != 0;
+    }
+    
+    if (failed) fprintf(stderr, "snapshot differs from the live tabs %s\n", what);
+    CHECK(!failed, "snapshot does not restore the live tabs");
+    return !failed;
+}
+
+static void save(SessionSnapshotWriter *writer, Session *session) {
+    CHECK(session_snapshot_writer_save(writer, session->manager) == 0, "session_snapshot_writer_save failed");
+}
+
+// Rebuild the tabs from the snapshot as the app does at startup, continuing
+// their history in the file through writer
+static Session* restore_session(SessionSnapshotWriter *writer, int *ids) {
+    SessionSnapshot *snapshot = open_snapshot();
+    Session *session = session_create();
+    if (!snapshot) return session;
+    
+    for (int i = 0; i < session_snapshot_get_tab_count(snapshot); i++) {
+        int index = session_add_tab(session, session_snapshot_get_tab_title(snapshot, i));
+        
+        for (int line = 0; line < session_snapshot_get_line_count(snapshot, i); line++) {
+            scrollback_add_line(session->scrollbacks[index], session_snapshot_get_line(snapshot, i, line));
+        }
+        session_snapshot_restore_screen(snapshot, i, session->terminals[index]);
+        
+        ids[index] = session_snapshot_get_tab_id(snapshot, i);
+        CHECK(session_snapshot_writer_bind(writer, session->terminals[index], ids[index]) == 0,
+              "session_snapshot_writer_bind failed");
+    }
+    
+    session_snapshot_close(snapshot);
+    return session;
+}
+
+static char* read_prefix(long length) {
+    char *data = (char *)malloc((size_t)length);
+    FILE *file = fopen(SNAPSHOT_PATH, "rb");
+    size_t read = file ? fread(data, 1, (size_t)length, file) : 0;
+    if (file) fclose(file);
+    CHECK(read == (size_t)length, "could not read the snapshot back");
+    return data;
+}
+
+static void cut_file(long size) {
+    CHECK(truncate(SNAPSHOT_PATH, size) == 0, "truncate failed");
+}
+
+// Length of the chunk starting at offset
+static uint64_t chunk_length_at(long offset) {
+    char header[16];
+    uint64_t length = 0;
+    FILE *file = fopen(SNAPSHOT_PATH, "rb");
+    if (file && fseek(file, offset, SEEK_SET) == 0 && fread(header, 1, sizeof(header), file) == sizeof(header)) {
+        memcpy(&length, header + 8, sizeof(length));
+    }
+    if (file) fclose(file);
+    return length;
+}
+
+int main(void) {
+    int ids[MAX_TABS];
+    TabState states[MAX_TABS];
+    
+    unlink(SNAPSHOT_PATH);
+    
+    // Fill, overflow and compact: the snapshot tracks the live tabs throughout
+    SessionSnapshotWriter *writer = session_snapshot_writer_create(SNAPSHOT_PATH);
+    CHECK(writer != NULL, "session_snapshot_writer_create failed on a new file");
+    if (!writer) return 1;
+    
+    Session *session = session_create();
+    session_add_tab(session, "build");
+    session_add_tab(session, "logs");
+    session_add_tab(session, "");
+    
+    int compactions = 0;
+    long last_size = 0;
+    for (int save_index = 0; save_index < SAVES; save_index++) {
+        for (int i = 0; i < session->count; i++) {
+            write_lines(session, i, LINES_PER_SAVE * (i + 1) / TAB_COUNT);
+        }
+        if (save_index == SAVES / 2) {
+            tab_set_title(tab_manager_get_tab(session->manager, 1), "logs (tail)");
+        }
+        save(writer, session);
+        
+        if (save_index == 0) {
+            int count = read_states(states);
+            CHECK(count == TAB_COUNT, "first save did not list every tab");
+            for (int i = 0; i < count; i++) ids[i] = states[i].id;
+        }
+        check_snapshot(session, ids, "while saving");
+        
+        if (file_size() < last_size) compactions++;
+        last_size = file_size();
+    }
+    CHECK(compactions >= 2, "the file was never compacted");
+    printf("%d saves, %d compactions, %ld bytes\n", SAVES, compactions, last_size);
+    
+    session_snapshot_writer_destroy(writer);
+    session_destroy(session);
+    
+    // A reopened writer appends to the file, restored tabs keep their ids,
+    // and a new tab gets an id none of them has
+    long size_before = file_size();
+    char *prefix = read_prefix(size_before);
+    int saved_ids[MAX_TABS];
+    memcpy(saved_ids, ids, sizeof(ids));
+    
+    writer = session_snapshot_writer_create(SNAPSHOT_PATH);
+    CHECK(writer != NULL, "session_snapshot_writer_create failed on its own file");
+    if (!writer) return 1;
+    
+    session = restore_session(writer, ids);
+    CHECK(session->count == TAB_COUNT, "restore lost tabs");
+    CHECK(memcmp(saved_ids, ids, sizeof(int) * TAB_COUNT) == 0, "restored tabs have other ids");
+    check_snapshot(session, ids, "right after restoring");
+    
+    write_lines(session, 0, 10);
+    save(writer, session);
+    check_snapshot(session, ids, "after reopening");
+    
+    char *after = read_prefix(size_before);
+    CHECK(file_size() > size_before, "the reopened writer did not append");
+    CHECK(memcmp(prefix, after, (size_t)size_before) == 0, "the reopened writer rewrote the file");
+    free(prefix);
+    free(after);
+    
+    int index = session_add_tab(session, "new");
+    write_lines(session, index, 5);
+    save(writer, session);
+    int count = read_states(states);
+    CHECK(count == TAB_COUNT + 1, "the new tab was not saved");
+    ids[index] = (count > index) ? states[index].id : -1;
+    for (int i = 0; i < index; i++) {
+        CHECK(ids[index] != ids[i], "the new tab reused an id");
+    }
+    check_snapshot(session, ids, "after adding a tab");
+    
+    // Bound ids survive compaction too
+    for (int save_index = 0; save_index < SAVES / 2; save_index++) {
+        for (int i = 0; i < session->count; i++) {
+            write_lines(session, i, LINES_PER_SAVE / TAB_COUNT);
+        }
+        save(writer, session);
+    }
+    check_snapshot(session, ids, "after compacting restored tabs");
+    
+    session_snapshot_writer_destroy(writer);
+    session_destroy(session);
+    
+    // Cut a save short: first inside its first chunk, then after that
+    // chunk's payload but before its padding. Either way the reader shows
+    // the save before it and a new writer drops the rest.
+    for (int cut = 0; cut < 2; cut++) {
+        writer = session_snapshot_writer_create(SNAPSHOT_PATH);
+        CHECK(writer != NULL, "session_snapshot_writer_create failed");
+        if (!writer) return 1;
+        session = restore_session(writer, ids);
+        save(writer, session);              // Titles and screens, so the next save only adds a line
+        
+        TabState before[MAX_TABS];
+        int before_count = read_states(before);
+        long size_saved = file_size();
+        
+        // One short line: a scrollback chunk with a payload that needs padding
+        scrollback_add_line(session->scrollbacks[0], "x");
+        save(writer, session);
+        session_snapshot_writer_destroy(writer);
+        session_destroy(session);
+        
+        uint64_t length = chunk_length_at(size_saved);
+        long cut_at = (cut == 0) ? size_saved + 20 : size_saved + 16 + (long)length;
+        CHECK(cut == 0 || length % 8 != 0, "the cut chunk needs no padding");
+        cut_file(cut_at);
+        
+        TabState torn[MAX_TABS];
+        int torn_count = read_states(torn);
+        CHECK(torn_count == before_count &&
+              memcmp(before, torn, sizeof(TabState) * before_count) == 0,
+              "the reader used a torn chunk");
+        
+        writer = session_snapshot_writer_create(SNAPSHOT_PATH);
+        CHECK(writer != NULL, "session_snapshot_writer_create failed on a torn file");
+        CHECK(file_size() == size_saved, "the writer did not drop the torn tail");
+        
+        session = restore_session(writer, ids);
+        write_lines(session, 1, 3);
+        save(writer, session);
+        check_snapshot(session, ids, "after a torn tail");
+        
+        session_snapshot_writer_destroy(writer);
+        session_destroy(session);
+    }
+    
+    // Files the writer does not know are left alone
+    FILE *file = fopen(SNAPSHOT_PATH, "wb");
+    fputs("not a snapshot\n", file);
+    fclose(file);
+    CHECK(session_snapshot_writer_create(SNAPSHOT_PATH) == NULL, "the writer took over another file");
+    CHECK(file_size() == 15, "the writer changed another file");
+    
+    unlink(SNAPSHOT_PATH);
+    
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    
+    printf("session snapshot: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,312 @@
+// Output trigger test: engine hits against a naive strstr over random lines.
+//
+// Lines and patterns are drawn from a tiny alphabet so patterns of 1 to 8
+// bytes match often, in both case modes. Lines go straight to the engine
+// and through terminals in random pieces (soft wraps, rows scrolling off,
+// unfinished lines queued at the end of each write). Every trigger has to
+// fire exactly for the lines that contain its pattern, and at most once per
+// line. Removing and clearing triggers takes effect at the next batch.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "terminal.h"
+#include "triggers.h"
+#include "scripting.h"
+
+#define MAX_TRIGGERS 24
+#define MAX_LINES 600
+#define MAX_LINE_LENGTH 240
+#define ROUNDS 12
+#define TERMINAL_WIDTH 40
+#define TERMINAL_HEIGHT 5
+
+static int failures = 0;
+
+#define CHECK(condition, message) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, message); \
+        failures++; \
+    } \
+} while (0)
+
+// Hits per line and trigger. Events carry the line, which starts with its
+// number; event names are "t<index>".
+static int hits[MAX_LINES][MAX_TRIGGERS];
+static int stray_events = 0;
+static int scripting_stand_in;      // Events are only delivered to a non-NULL engine
+
+// Stands in for the scripting engine, which needs Foundation. Runs on the
+// trigger thread; trigger_engine_flush orders it before the checks.
+int scripting_engine_trigger_event(ScriptingEngine* engine, const char* event_name, const char* data) {
+    (void)engine;
+    int line = atoi(data);
+    int trigger = (event_name[0] == 't') ? atoi(event_name + 1) : -1;
+    
+    if (line < 0 || line >= MAX_LINES || trigger < 0 || trigger >= MAX_TRIGGERS) {
+        stray_events++;
+        return 0;
+    }
+    hits[line][trigger]++;
+    return 0;
+}
+
+typedef struct {
+    char pattern[16];
+    int id;                 // -1 once removed
+} TestTrigger;
+
+static TestTrigger triggers[MAX_TRIGGERS];
+static int trigger_count = 0;
+static char lines[MAX_LINES][MAX_LINE_LENGTH + 16];
+
+static void random_text(char *text, int length) {
+    static const char alphabet[] = "abAB ";
+    for (int i = 0; i < length; i++) {
+        text[i] = alphabet[rand() % 5];
+    }
+    text[length] = '\0';
+}
+
+static void add_trigger(TriggerEngine *engine, const char *pattern) {
+    TestTrigger *trigger = &triggers[trigger_count];
+    char event_name[16];
+    
+    snprintf(trigger->pattern, sizeof(trigger->pattern), "%s", pattern);
+    snprintf(event_name, sizeof(event_name), "t%d", trigger_count);
+    trigger->id = trigger_engine_add_trigger(engine, pattern, event_name);
+    CHECK(trigger->id >= 0, "trigger_engine_add_trigger failed");
+    trigger_count++;
+}
+
+// Patterns of 1 to 8 bytes, short ones included on purpose
+static void add_random_triggers(TriggerEngine *engine, int count) {
+    char pattern[16];
+    for (int i = 0; i < count && trigger_count < MAX_TRIGGERS; i++) {
+        random_text(pattern, 1 + rand() % 8);
+        add_trigger(engine, pattern);
+    }
+}
+
+// Line numbers are digits, which no pattern contains
+static void make_lines(int first, int count) {
+    for (int i = first; i < first + count; i++) {
+        int length = sprintf(lines[i], "%04d:", i);
+        random_text(lines[i] + length, rand() % MAX_LINE_LENGTH);
+    }
+}
+
+static void clear_hits(void) {
+    memset(hits, 0, sizeof(hits));
+}
+
+// Every live trigger fired once for each line containing its pattern and
+// never for the others; removed triggers never fired
+static void check_hits(int first, int count, int case_sensitive, const char *what) {
+    int missed = 0, extra = 0, repeated = 0;
+    
+    for (int i = first; i < first + count; i++) {
+        for (int t = 0; t < trigger_count; t++) {
+            int expected = 0;
+            if (triggers[t].id >= 0) {
+                expected = case_sensitive ? strstr(lines[i], triggers[t].pattern) != NULL
+                                          : strcasestr(lines[i], triggers[t].pattern) != NULL;
+            }
+            
+            if (hits[i][t] > 1) repeated++;
+            else if (hits[i][t] < expected) missed++;
+            else if (hits[i][t] > expected) extra++;
+        }
+    }
+    
+    if (missed || extra || repeated) {
+        fprintf(stderr, "%s: %d missed, %d extra, %d fired more than once\n", what, missed, extra, repeated);
+    }
+    CHECK(missed == 0, "a trigger missed a line containing its pattern");
+    CHECK(extra == 0, "a trigger fired for a line without its pattern");
+    CHECK(repeated == 0, "a trigger fired more than once for a line");
+}
+
+static void queue_lines(TriggerEngine *engine, int first, int count) {
+    for (int i = first; i < first + count; i++) {
+        trigger_engine_queue_line(engine, lines[i], (int)strlen(lines[i]));
+        if (rand() % 8 == 0) trigger_engine_publish(engine);
+    }
+    trigger_engine_publish(engine);
+}
+
+// Each line in random pieces; every write also queues the unfinished line
+static void write_lines(Terminal *terminal, int first, int count) {
+    for (int i = first; i < first + count; i++) {
+        int length = (int)strlen(lines[i]);
+        int offset = 0;
+        
+        while (offset < length) {
+            int piece = 1 + rand() % (length - offset);
+            terminal_write(terminal, lines[i] + offset, piece);
+            offset += piece;
+        }
+        terminal_write(terminal, "\r\n", 2);
+    }
+}
+
+static void test_random_lines(int use_terminal) {
+    for (int round = 0; round < ROUNDS; round++) {
+        int case_sensitive = round % 2;
+        TriggerEngine *engine = trigger_engine_create((ScriptingEngine *)&scripting_stand_in);
+        Terminal *terminal = terminal_create(TERMINAL_WIDTH, TERMINAL_HEIGHT);
+        const char *what = use_terminal ? "terminal" : "engine";
+        int half = MAX_LINES / 2;
+        
+        trigger_count = 0;
+        trigger_engine_set_case_sensitive(engine, case_sensitive);
+        terminal_set_trigger_engine(terminal, engine);
+        add_random_triggers(engine, MAX_TRIGGERS / 2);
+        
+        clear_hits();
+        make_lines(0, MAX_LINES);
+        
+        if (use_terminal) write_lines(terminal, 0, half);
+        else queue_lines(engine, 0, half);
+        trigger_engine_flush(engine);
+        check_hits(0, half, case_sensitive, what);
+        
+        // Remove some triggers and add others, the automaton is rebuilt on the next batch
+        for (int t = 0; t < trigger_count; t++) {
+            if (rand() % 3 == 0) {
+                CHECK(trigger_engine_remove_trigger(engine, triggers[t].id) == 0, "remove failed");
+                triggers[t].id = -1;
+            }
+        }
+        add_random_triggers(engine, MAX_TRIGGERS / 2);
+        
+        if (use_terminal) write_lines(terminal, half, MAX_LINES - half);
+        else queue_lines(engine, half, MAX_LINES - half);
+        trigger_engine_flush(engine);
+        check_hits(half, MAX_LINES - half, case_sensitive, what);
+        
+        CHECK(trigger_engine_get_dropped_count(engine) == 0, "lines or events were dropped");
+        CHECK(stray_events == 0, "an event did not name a known line and trigger");
+        
+        terminal_destroy(terminal);
+        trigger_engine_destroy(engine);
+    }
+}
+
+static void test_clear(void) {
+    TriggerEngine *engine = trigger_engine_create((ScriptingEngine *)&scripting_stand_in);
+    
+    trigger_count = 0;
+    add_trigger(engine, "a");
+    clear_hits();
+    snprintf(lines[0], sizeof(lines[0]), "0000:a");
+    
+    trigger_engine_clear(engine);
+    CHECK(trigger_engine_get_trigger_count(engine) == 0, "clear left triggers");
+    CHECK(trigger_engine_queue_line(engine, lines[0], (int)strlen(lines[0])) == 0,
+          "a line was queued with no triggers");
+    triggers[0].id = -1;
+    
+    // A trigger added after a clear works without anything else happening first
+    add_trigger(engine, "a");
+    trigger_engine_queue_line(engine, lines[0], (int)strlen(lines[0]));
+    trigger_engine_publish(engine);
+    trigger_engine_flush(engine);
+    check_hits(0, 1, 1, "after clear");
+    
+    trigger_engine_destroy(engine);
+}
+
+// Hits of trigger t over all lines
+static int total_hits(int t) {
+    int total = 0;
+    for (int i = 0; i < MAX_LINES; i++) total += hits[i][t];
+    return total;
+}
+
+static void write_text(Terminal *terminal, const char *text) {
+    terminal_write(terminal, text, (int)strlen(text));
+}
+
+static void test_terminal_lines(void) {
+    TriggerEngine *engine = trigger_engine_create((ScriptingEngine *)&scripting_stand_in);
+    Terminal *first = terminal_create(TERMINAL_WIDTH, TERMINAL_HEIGHT);
+    Terminal *second = terminal_create(TERMINAL_WIDTH, TERMINAL_HEIGHT);
+    
+    trigger_count = 0;
+    add_trigger(engine, "Password: ");      // t0
+    add_trigger(engine, "%");               // t1
+    add_trigger(engine, "done");            // t2
+    add_trigger(engine, "wrapped");         // t3, straddles a soft wrap below
+    terminal_set_trigger_engine(first, engine);
+    terminal_set_trigger_engine(second, engine);
+    clear_hits();
+    
+    // A prompt fires before its newline, and not again once the line ends
+    write_text(first, "0000:Password: ");
+    trigger_engine_flush(engine);
+    CHECK(hits[0][0] == 1, "prompt did not fire before the newline");
+    write_text(first, "*");
+    write_text(first, "\r\n");
+    trigger_engine_flush(engine);
+    CHECK(hits[0][0] == 1, "prompt fired again when the line ended");
+    
+    // Two terminals sharing the engine each have their own open line
+    clear_hits();
+    write_text(first, "0001:Password: ");
+    write_text(second, "0002:Password: ");
+    write_text(first, "*");
+    write_text(second, "*");
+    write_text(first, "\r\n");
+    write_text(second, "\r\n");
+    trigger_engine_flush(engine);
+    CHECK(hits[1][0] == 1 && hits[2][0] == 1, "a shared engine fired a prompt twice or not at all");
+    
+    // A progress line rewritten after \r fires each trigger once
+    clear_hits();
+    write_text(first, "0003:  1%");
+    write_text(first, "\r0003: 50%");
+    write_text(first, "\r0003:100% done");
+    write_text(first, "\r\n");
+    trigger_engine_flush(engine);
+    CHECK(total_hits(1) == 1, "a rewritten line fired more than once");
+    CHECK(total_hits(2) == 1, "the last version of a rewritten line did not fire");
+    
+    // Soft-wrapped rows are one line, even once its first rows scrolled off
+    clear_hits();
+    char line[TERMINAL_WIDTH * TERMINAL_HEIGHT * 2];
+    memset(line, '.', sizeof(line));
+    memcpy(line, "0004:", 5);
+    memcpy(line + TERMINAL_WIDTH - 3, "wrapped", 7);
+    memcpy(line + sizeof(line) - 5, "done", 4);
+    line[sizeof(line) - 1] = '\0';
+    write_text(first, line);
+    write_text(first, "\r\n");
+    trigger_engine_flush(engine);
+    CHECK(hits[4][3] == 1, "a pattern across a soft wrap did not fire");
+    CHECK(hits[4][2] == 1, "the end of a line longer than the screen did not fire");
+    
+    CHECK(trigger_engine_get_dropped_count(engine) == 0, "lines or events were dropped");
+    
+    terminal_destroy(first);
+    terminal_destroy(second);
+    trigger_engine_destroy(engine);
+}
+
+int main(void) {
+    srand(28);
+    
+    test_random_lines(0);
+    test_random_lines(1);
+    test_clear();
+    test_terminal_lines();
+    
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    
+    printf("triggers: all checks passed\n");
+    return 0;
+}